@@ -6,16 +6,188 @@
 #include<stdlib.h>
 #include<stdio.h>
 #include <limits.h>
-#define MAX 10000
+#include <float.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+/*----- Capacity Type, chosen at compile time : -DCAP_INT64 or -DCAP_DOUBLE (32 bit int when neither is given) -----*/
+#if defined(CAP_DOUBLE)
+typedef double CAP;
+#define CAP_MAX     DBL_MAX
+#define CAP_EPS     1e-9            // Residual capacities & excesses up to CAP_EPS count as zero
+#define CAP_FMT     "%.15g"
+#define CAP_SCAN    "%lf"
+#define CAP_CODE    3
+typedef double CAPWIDE;             // Type of sums of capacities that may not fit in CAP (checked before narrowing to CAP)
+typedef double COSTSUM;             // Type of total flow cost (sum of flow * cost)
+#define COST_FMT    "%.15g"
+#elif defined(CAP_INT64)
+typedef long long CAP;
+#define CAP_MAX     LLONG_MAX
+#define CAP_EPS     0
+#define CAP_FMT     "%lld"
+#define CAP_SCAN    "%lld"
+#define CAP_CODE    2
+__extension__ typedef __int128 CAPWIDE;
+typedef long long COSTSUM;
+#define COST_FMT    "%lld"
+#else
+typedef int CAP;
+#define CAP_MAX     INT_MAX
+#define CAP_EPS     0
+#define CAP_FMT     "%d"
+#define CAP_SCAN    "%d"
+#define CAP_CODE    1
+typedef long long CAPWIDE;
+typedef long long COSTSUM;
+#define COST_FMT    "%lld"
+#endif
+#define CAP_POSITIVE(x)  ((x) > CAP_EPS)                                  // x can still carry flow
+#define CAP_EQUAL(x, y)  (!CAP_POSITIVE((x) - (y)) && !CAP_POSITIVE((y) - (x)))
+#define CAP_UNIT(x)      (!CAP_POSITIVE(x) || CAP_EQUAL((x), 1))   // Capacity allowed in a unit capacity graph (0 or 1)
+typedef _Atomic CAP ATOMIC_CAP;
+
+/*----- Min-Cost Flow -----*/
+#define MCF_ALPHA      16           // Factor by which epsilon shrinks between two refines of cost scaling
+
+/*----- Binary Graph Format -----*/
+#define BINARY_MAGIC   0x4247464D   // "MFGB" in little endian byte order
+#define BINARY_VERSION 2
+#define BINARY_HEADER  6            // Number of ints in header : magic, version, CAP_CODE, V, E, A
+#define LOAD_ERROR     512          // Size of the message buffer filled by LoadGraph when a graph file cannot be read
+#define TEXT_SPACE(c)  ((c) == ' ' || (c) == '\t' || (c) == '\n' || (c) == '\r')   // Characters separating numbers of a text graph
+
+/*----- Solver Engines -----*/
+#define ENGINE_EDMONDS_KARP 0
+#define ENGINE_DINIC        1
+#define ENGINE_PUSH_RELABEL 2
+#define ENGINE_PARALLEL_PR  3
+#define ENGINE_SCALING      4
+#define ENGINE_BOYKOV_KOLMOGOROV 5
+#define SCALING_BUCKETS     64      // Capacity scaling phases counted by instrumentation (bucket k+1 : delta = 2^k, 0 : delta = 0)
+
+/*----- Boykov-Kolmogorov Search Trees -----*/
+#define BK_FREE             0       // tree[v] : v belongs to no search tree
+#define BK_SOURCE           1       // tree[v] : v belongs to the source tree
+#define BK_SINK             2       // tree[v] : v belongs to the sink tree
+#define BK_TERMINAL        -1       // parent[v] : v is the root of its tree (s or t)
+#define BK_ORPHAN          -2       // parent[v] : the arc to the parent of v was saturated, v waits for adoption
+#define BK_NONE            -3       // parent[v] : v is free
+
+/*----- Direction optimizing BFS -----*/
+#define BFS_ALPHA           2       // Go bottom-up when arcs of the frontier exceed unexplored arcs / BFS_ALPHA (lower than the
+                                    // usual 14 : vertices cut off in residual networks never end a bottom-up scan early)
+#define BFS_BETA            24      // Go back top-down when the frontier has fewer than V / BFS_BETA vertices
+
+/*----- Tasks of the parallel push-relabel threads -----*/
+#define PPR_TASK_EXIT       0
+#define PPR_TASK_DISCHARGE  1
+#define PPR_TASK_EXPAND     2
+
+/*----- Parallel BFS -----*/
+#define PBFS_TASK_EXIT      0
+#define PBFS_TASK_TOP_DOWN  1
+#define PBFS_TASK_BOTTOM_UP 2
+#define PBFS_CHUNK          256     // Frontier (top-down) or graph (bottom-up) vertices claimed by a thread at a time
+#define PBFS_BUFFER         256     // Size of the next frontier buffer of a thread, flushed to the shared queue when full
+#define PBFS_GRAIN          4096    // Top-down levels with fewer arcs are expanded by the calling thread alone
+
+/*----- Batch Mode -----*/
+#define TASK_MAX            1       // Batch tasks are bit masks : max flow from s to t,
+#define TASK_NEED           2       // need based flow,
+#define TASK_BOTH           3       // or both on the same loaded graph
+#define OUTPUT_VALUE        0       // Batch output : one result line per task
+#define OUTPUT_NONZERO      1       // result line, then "x y f" for every edge with non zero flow
+#define OUTPUT_CUT          2       // result line, then "x y c" for every edge of a minimum cut
+#define OUTPUT_BINARY       3       // binary flow dump (see WriteBatchResult)
+#define OUTPUT_BUFFER       (1 << 22)   // Size of the stdio buffer of batch output (bytes)
+#define FLOWDUMP_MAGIC      0x4446464D  // "MFFD" in little endian byte order
+#define POOL_TASK_LOAD      0       // Job pool task : read a graph file, solve its need based flow & start its jobs
+#define POOL_TASK_SOLVE     1       // Job pool task : solve the tasks of one job on the shared graph
+
+/*----- Graph Reduction -----*/
+#define REDUCE_LEAF         0       // Reduction node standing for one edge of the graph
+#define REDUCE_SERIES       1       // two nodes in series (flow of both is the flow of the node)
+#define REDUCE_PARALLEL     2       // two nodes in parallel (flow of the node is split between both)
+
+/*----- Vertex Reordering -----*/
+#define REORDER_NONE        0       // Vertices keep the numbering of the input file
+#define REORDER_BFS         1       // Breadth first order (neighbours get close ids)
+#define REORDER_RCM         2       // Reverse Cuthill-McKee order (small bandwidth)
+#define REORDER_DEGREE      3       // Decreasing degree (hubs first)
+#define REORDER_HUB         64      // bfs & rcm do not expand vertices of more than REORDER_HUB times the average degree
+
+/*----- Benchmark Phases -----*/
+#define BENCH_PHASES        7   // load, reorder, setup, solve, need_construct, need_setup, need_solve
+#define GEN_MAX_EDGES       (1 << 30)   // Most edges a generated instance may have (the int sized edge list doubles up to it)
+#define GEN_MAX_SCALE       27          // Largest rmat scale, 8 * 2^27 edges is GEN_MAX_EDGES
+
+/*----- Graph Arenas -----*/
+#define ARENA_CHUNK     (1 << 16)   // Smallest block an arena asks malloc for (bytes)
+#define ARENA_ALIGN     16          // Alignment of every arena allocation (bytes)
+#define ARENA_POOL_MAX  8           // Number of released arenas kept for recycling
+
+/*----- Solver Instrumentation, compiled in only with -DMAXFLOW_STATS (statements inside STAT vanish otherwise) -----*/
+#ifdef MAXFLOW_STATS
+#define STAT(statement)      statement
+#define STAT_ADD(field, n)   atomic_fetch_add_explicit(&Stats.field, (n), memory_order_relaxed)
+#define STAT_TIME(field, start) STAT_ADD(field, (long)((WallTime() - (start))*1e9))   // Adds the nanoseconds since start
+#else
+#define STAT(statement)
+#define STAT_ADD(field, n)
+#define STAT_TIME(field, start)
+#endif
+
+int Engine = ENGINE_EDMONDS_KARP;   // Engine used by ComputeMaxFlow, selected with command line option -e <name>
+int EngineChosen = 0;               // 1 if -e was given, unit capacity graphs then keep the engine (no Hopcroft-Karp or Dinic)
+int Threads = 1;                    // Number of threads used by parallel engines, selected with command line option -t <count>
+int Reduce = 0;                     // 1 if SolveMaxFlow solves on the reduced graph, selected with command line option -reduce
+int Reorder = REORDER_NONE;         // Vertex order applied after loading a graph, selected with command line option -reorder <name>
+double Budget = 0;                  // Wall time (seconds) a max flow may take before engines stop, set with -budget <ms> (0 : none)
+long StepBudget = 0;                // Steps a max flow may take before engines stop, set with -steps <n> (0 : none)
+
+struct arena *ArenaPool = NULL;     // Released arenas waiting to be reused by the next graph
+int ArenaPoolSize = 0;              // Number of arenas in ArenaPool
+pthread_mutex_t ArenaPoolLock = PTHREAD_MUTEX_INITIALIZER;
 
 /*------------------------------------------------------------------------------------------------------------------------------------------------*/
 /*----- Structures -----*/
 
+typedef struct arenachunk {
+
+    /* Block of memory handed out by an arena, the usable bytes follow the (ARENA_ALIGN padded) header */
+
+    struct arenachunk *next;    // pointer next storing the previously filled chunk of the arena
+    size_t size;                // integer size storing the number of usable bytes of the chunk
+    size_t used;                // integer used storing the number of bytes handed out from the chunk
+
+}ARENACHUNK;
+
+typedef struct arena {
+
+    /* Bump allocator owning all memory of one graph (or one residual network). Nothing is freed on its own, the whole
+       arena is released at once by ReleaseArena, which keeps it in a pool so the next graph reuses its memory         */
+
+    ARENACHUNK *chunk;  // pointer chunk storing the chunk being filled (head of the list of chunks)
+    size_t total;       // integer total storing the number of usable bytes of all chunks
+    struct arena *next; // pointer next storing the next arena of the pool of released arenas
+
+}ARENA;
+
 typedef struct edge {
 
     int y;              // integer y storing the endpoint vertex y of an edge (x, y) (edge from x to y)
-    int c;              // integer c storing the capacity of the edge
-    int f;              // integer f storing the flow value to be assigned on the edge
+    CAP c;              // CAP c storing the capacity of the edge
+    CAP f;              // CAP f storing the flow value to be assigned on the edge
+    int w;              // integer w storing the cost per unit of flow on the edge (0 when the input gives no cost)
     struct edge *next;  // pointer next to store edges in an adjacency list
 
 }EDGE;
@@ -23,7 +195,7 @@ typedef struct edge {
 typedef struct vertex {
 
     int x;              // integer x storing the id of the vertex
-    int n;              // integer n storing the need value of the vertex 
+    CAP n;              // CAP n storing the need value of the vertex 
     EDGE *p;            // pointer p storing a pointer to an EDGE node 
 
 }VERTEX;
@@ -32,71 +204,625 @@ typedef struct graph {
 
     int V;              // integer V storing the number of vertices
     int E;              // integer E storing the number of edges
-    VERTEX *H;          // pointer H storing a pointer to an array of VERTEX nodes
+    int W;              // integer W storing 1 if some edge has a non zero cost, 0 if not
+    int U;              // integer U storing 1 if every edge has capacity 0 or 1 (unit capacity graph), 0 if not
+    VERTEX *H;          // pointer H storing a pointer to an array of VERTEX nodes (H[v].x is the id of v in the input file)
+    int *rank;          // rank[x] stores the vertex numbered x in the input file (NULL while vertices keep file order)
+    struct residual *R; // pointer R storing the residual network of the graph (NULL until built, reset when edges change)
+    ARENA *arena;       // pointer arena storing the arena the graph, its vertices & its edges are allocated from
 
 }GRAPH;
 
+typedef struct residual {
+
+    /* Residual network stored in compressed sparse row (CSR) form. Every edge of the graph contributes a forward arc
+       and a paired reverse arc (capacity 0), so the partner of any arc is reached in O(1) through rev[]             */
+
+    int V;              // integer V storing the number of vertices
+    int A;              // integer A storing the number of arcs (2 * number of edges with positive capacity)
+    int *first;         // arcs leaving vertex v are stored at indices first[v] .. first[v+1]-1
+    int *head;          // head[a] stores the vertex arc a points to
+    CAP *cap;           // cap[a] stores the capacity of arc a (0 for reverse arcs)
+    CAP *flow;          // flow[a] stores the flow on arc a, flow[rev[a]] is always -flow[a]
+    int *rev;           // rev[a] stores the index of the arc paired with arc a
+    int *cost;          // cost[a] stores the cost per unit of flow on arc a, cost[rev[a]] = -cost[a] (NULL when W is 0)
+    EDGE **edge;        // edge[a] stores the EDGE a forward arc was built from (NULL for reverse arcs)
+    struct boykovkolmogorov *bk; // pointer bk storing the search trees of the last Boykov-Kolmogorov solve (NULL if none)
+    double deadline;    // wall time at which engines stop augmenting (0 : no deadline)
+    long steps;         // steps engines may still take (augmenting paths, discharges, rounds), negative : no limit
+    int stopped;        // integer stopped storing 1 if an engine stopped on deadline or steps, the flow is then not maximum
+    void *map;          // pointer map storing the binary graph file first, head, cap & rev point into (NULL if malloc'd)
+    size_t mapSize;     // size of the mapping
+    ARENA *arena;       // pointer arena storing the arena the residual network (including this struct) is allocated from
+
+}RESIDUAL;
+
+typedef struct capupdate {
+
+    int x;              // integer x storing the start vertex of the edge to be updated
+    int y;              // integer y storing the end vertex of the edge to be updated
+    CAP c;              // CAP c storing the new capacity of the edge
+
+}CAPUPDATE;
+
+typedef struct cuttree {
+
+    /* Gomory-Hu (equivalent flow) tree rooted at vertex 1 : the maximum flow between any two vertices is the minimum
+       weight on the tree path between them. up & low allow path minimum queries by binary lifting in O(log V)        */
+
+    int V;              // integer V storing the number of vertices
+    int *parent;        // parent[v] stores the parent of v in the tree (parent of root 1 is 1)
+    CAP *weight;        // weight[v] stores the maximum flow between v & parent[v]
+    int *depth;         // depth[v] stores the number of tree edges between v & the root
+    int LOG;            // integer LOG storing the number of levels of up & low
+    int **up;           // up[k][v] stores the 2^k-th ancestor of v
+    CAP **low;          // low[k][v] stores the minimum weight on the 2^k tree edges above v
+
+}CUTTREE;
+
+typedef struct cutjob {
+
+    /* One minimum cut computation of the Gomory-Hu tree construction, run by one thread */
+
+    RESIDUAL R;         // residual network sharing first, head, cap & rev with all jobs, but owning its flow array
+    int s, t;           // integer s & t storing the vertex pair of the cut
+    CAP value;          // CAP value storing the minimum cut value
+    char *side;         // side[v] is 1 if v is on the side of s
+    int *queue;         // array used as queue by the BFS finding the side of s
+
+}CUTJOB;
+
+typedef struct reduction {
+
+    /* Reduced network of a graph for one s-t solve, with the mapping needed to expand its flow onto the edges.
+       Every arc pair of the reduced network carries a tree of nodes : leaves are edges of the graph, series nodes
+       join two chain segments & parallel nodes join parallel (or merged antiparallel) segments                    */
+
+    RESIDUAL *R;        // pointer R storing the reduced residual network (vertices renumbered 1 .. R->V)
+    int *vertex;        // vertex[v] stores the vertex of the reduced network for vertex v of the graph (0 if removed)
+    int pairs;          // integer pairs storing the number of arc pairs of the reduced network
+    int *arc;           // arc[k] stores the arc of pair k leading from its smaller to its larger graph vertex
+    int *forward;       // forward[k] stores the node carrying flow along arc[k] (-1 if none)
+    int *backward;      // backward[k] stores the node carrying flow against arc[k] (-1 if none)
+    int nodes;          // integer nodes storing the number of nodes
+    char *kind;         // kind[n] stores REDUCE_LEAF, REDUCE_SERIES or REDUCE_PARALLEL
+    int *left, *right;  // left[n] & right[n] store the two parts of series & parallel nodes
+    CAP *cap;           // cap[n] stores the capacity of node n
+    EDGE **leaf;        // leaf[n] stores the edge of leaf nodes
+
+}REDUCTION;
+
+typedef struct batchjob {
+
+    /* One job of the batch mode, given by -run or by one line of a manifest file */
+
+    char *file;         // character pointer storing the graph file name
+    int s, t;           // integer s & t storing source & sink of the max flow task
+    int task;           // integer task storing the tasks to run (TASK_*)
+    int output;         // integer output storing what is written for every task (OUTPUT_*)
+
+}BATCHJOB;
+
+typedef struct poolfile {
+
+    /* Graph file shared by the jobs of the job pool that name it. The graph is read once & is not changed by the jobs :
+       every max flow task copies the RESIDUAL struct of R with a flow array of its own, & the need based flow, which does
+       not depend on s & t, is solved once on the graph itself before its jobs are started                              */
+
+    char *name;         // character pointer storing the graph file name
+    GRAPH *G;           // pointer G storing the graph (with universal source & sink once the need based flow is solved)
+    RESIDUAL *R;        // pointer R storing the residual network of the graph as read (NULL if no job has a max flow task)
+    int V;              // integer V storing the number of vertices of the graph as read
+    int unit;           // integer unit storing G->U of the graph as read
+    int task;           // integer task storing the union of the tasks of its jobs
+    CAP needValue;      // CAP needValue storing the value of the need based flow
+    int feasible;       // integer feasible storing 1 if the need based flow is feasible
+    int *job;           // job[i] stores the index of the i-th job reading the file
+    int jobs;           // integer jobs storing the number of jobs reading the file
+    atomic_int users;   // number of jobs not finished yet, the last one releases graph & residual network
+    double loadTime;    // wall time (seconds) spent reading the file
+    double needTime;    // wall time (seconds) spent on the need based flow
+
+}POOLFILE;
+
+typedef struct pooltask {
+
+    int kind;           // integer kind storing the kind of task (POOL_TASK_*)
+    int index;          // integer index storing the file (POOL_TASK_LOAD) or job (POOL_TASK_SOLVE) of the task
+
+}POOLTASK;
+
+typedef struct poolqueue {
+
+    /* Task queue of one worker of the job pool. The owner pushes & takes tasks at the tail (newest first), idle workers
+       steal from the head (oldest first), both under the lock of the queue                                          */
+
+    POOLTASK *task;     // array of tasks, the queue holds task[head .. tail-1]
+    int head, tail;     // integer head & tail storing the first used & first free entry of task
+    int size;           // integer size storing the allocated length of task
+    pthread_mutex_t lock;
+    struct jobpool *pool; // pointer pool storing the pool the queue belongs to
+    int id;             // integer id storing the index of the worker owning the queue
+
+}POOLQUEUE;
+
+typedef struct jobpool {
+
+    /* Work-stealing pool running batch jobs concurrently. Results are written to the output stream in job order, each job
+       writing into a memory stream of its own that is copied out once every earlier job has been written               */
+
+    BATCHJOB *job;      // array of jobs
+    int count;          // integer count storing the number of jobs
+    POOLFILE *file;     // array of distinct graph files
+    int files;          // integer files storing the number of distinct graph files
+    int *fileOf;        // fileOf[j] stores the index of the file of job j
+    POOLQUEUE *queue;   // queue[i] stores the task queue of worker i
+    int threads;        // integer threads storing the number of workers (including the calling thread)
+    atomic_int pending; // number of tasks pushed & not finished yet, the workers stop when it reaches 0
+    atomic_long pushes; // number of tasks pushed by running tasks, an idle worker sleeps until it changes
+    pthread_mutex_t idleLock;
+    pthread_cond_t idle; // signalled when a task is pushed, broadcast when pending reaches 0
+    FILE *out;          // output stream of the batch
+    char **text;        // text[j] stores the output of job j until it is written (NULL while job j runs)
+    size_t *length;     // length[j] stores the length of text[j]
+    int written;        // integer written storing the number of jobs whose output has been written
+    pthread_mutex_t outLock;
+    atomic_int failed;  // number of jobs that wrote an error line
+
+}JOBPOOL;
+
+typedef struct edgelist {
 
-typedef struct queue { 
+    /* Growing list of edges written by the benchmark instance generators */
 
-    /* Queue for performing BFS (Queue has been implemented using array) */
+    int V;              // integer V storing the number of vertices
+    int E;              // integer E storing the number of edges in the list
+    int size;           // integer size storing the allocated length of x, y & c
+    int *x, *y, *c;     // edge i goes from x[i] to y[i] with capacity c[i]
+
+}EDGELIST;
+
+typedef struct pushrelabel {
+
+    /* Working state of the highest-label push-relabel engine. Vertices are kept in buckets by height : a list of active
+       vertices (positive excess) & a doubly linked list of all vertices per height, the latter is used by the gap heuristic.
+       Vertex id 0 is unused, so 0 marks the end of a list                                                                  */
+
+    RESIDUAL *R;        // pointer R storing the residual network the engine works on
+    int s, t;           // integer s & t storing the source & sink vertex
+    CAP *excess;        // excess[v] stores inflow - outflow of vertex v
+    int *height;        // height[v] stores the distance label of vertex v (V means v cannot reach t)
+    int *it;            // it[v] stores the current arc of vertex v
+    int *activeHead;    // activeHead[h] stores the first active vertex with height h
+    int *activeNext;    // activeNext[v] stores the next active vertex with the same height as v
+    int *allHead;       // allHead[h] stores the first vertex with height h
+    int *allNext;       // allNext[v] & allPrev[v] store the neighbours of v in the list of vertices with the same height
+    int *allPrev;
+    int maxActive;      // integer maxActive storing the highest height that may hold an active vertex
+    int maxAll;         // integer maxAll storing the highest height that may hold a vertex
+    int *queue;         // array used as queue by the global relabel BFS
+    long work;          // integer work storing the relabel work done since the last global relabel
+
+}PUSHRELABEL;
+
+typedef struct boykovkolmogorov {
+
+    /* Search trees of the Boykov-Kolmogorov engine. parent[v] is the arc of v that leads to its parent : the source tree
+       needs residual capacity from the parent to v (on rev[parent[v]]), the sink tree from v to the parent. The trees are
+       kept in the residual network after a solve, so the next solve from the same s & t continues from them. Flow changes
+       made in between (capacity updates) list the vertices they touch in changed, & only those are checked again       */
+
+    int V;              // integer V storing the number of vertices (ring buffers hold V+1 entries)
+    int s, t;           // integer s & t storing the roots of the source & sink tree
+    char *tree;         // tree[v] stores BK_FREE, BK_SOURCE or BK_SINK
+    int *parent;        // parent[v] stores the arc from v to its parent, or BK_TERMINAL, BK_ORPHAN, BK_NONE
+    int *dist;          // dist[v] stores the number of tree arcs from v to its root (1 for the root), exact if ts[v] == time
+    int *ts;            // ts[v] stores the time dist[v] was last computed
+    int time;           // integer time storing the clock of dist, advanced by every augmentation
+    int *it;            // it[v] stores the next arc of v to be scanned by growth (reset whenever v is activated)
+    int *active;        // ring buffer of active vertices (vertices that may still grow their tree)
+    int activeFront, activeCount;
+    char *isActive;     // isActive[v] is 1 while v is in the ring buffer or being grown
+    int *orphan;        // ring buffer of orphans waiting for a new parent
+    int orphanFront, orphanCount;
+    int *changed;       // vertices whose arcs changed since the last solve
+    int changedCount;
+    char *isChanged;    // isChanged[v] is 1 while v is listed in changed
+
+}BOYKOVKOLMOGOROV;
+
+typedef struct parallelpr {
+
+    /* Shared state of the parallel (lock-free) push-relabel engine. Residual capacities, excesses & heights are atomics,
+       a vertex is only pushed from / relabelled by the thread that claimed it from the active list of the current round,
+       while any thread may push into it. Worker threads wait on a barrier for the next task set by the main thread      */
+
+    RESIDUAL *R;        // pointer R storing the residual network the engine works on
+    int s, t;           // integer s & t storing the source & sink vertex
+    ATOMIC_CAP *res;    // res[a] stores the residual capacity of arc a
+    ATOMIC_CAP *excess; // excess[v] stores inflow - outflow of vertex v
+    atomic_int *height; // height[v] stores the distance label of vertex v
+    atomic_int *queued; // queued[v] is 1 while vertex v is waiting in the active list of the next round
+    int *active;        // active vertices of the current round (also frontier of the global relabel BFS)
+    int activeCount;
+    int *next;          // active vertices of the next round (also next frontier of the global relabel BFS)
+    atomic_int nextCount;
+    atomic_int cursor;  // index of the next entry of active to be claimed by a thread
+    atomic_long relabels; // number of relabels since the last global relabel
+    int level;          // integer level storing the BFS level being expanded by the global relabel
+    int task;           // task run by the threads in the current step (PPR_TASK_*)
+    pthread_barrier_t barrier;
+
+}PARALLELPR;
+
+typedef struct parallelbfs {
+
+    /* Shared state of the parallel BFS of a solve. Worker threads are started once per solve & wait on a barrier for every
+       level. mark[v] packs the level that reached v (high 32 bits) & the arc entering v (low 32 bits). Levels are numbered
+       across all BFS of the solve, so a vertex is visited by the current BFS when its level is at least base. Top-down
+       threads lower the arc of a vertex reached in this level with compare & swap, so every vertex ends up with the
+       smallest arc from the previous level, whatever the thread count & timing                                          */
 
-    int front, rear;   //integer front & rear to keep track of front index & rear index respectively
-    int size;          //integer size to keep track of current size of queue
-    int capacity;      //integer capacity to store Maximum capacity of queue
-    int* array;        //pointer to interger array storing elements in queue
+    RESIDUAL *R;        // pointer R storing the residual network of the current BFS
+    int threads;        // integer threads storing the number of threads (including the calling one)
+    atomic_ullong *mark; // mark[v] stores (level << 32) | arc entering v of the last BFS that reached v
+    unsigned level;     // integer level storing the level given to vertices reached by the step being run
+    unsigned base;      // integer base storing the level of the source of the current BFS
+    int t;              // integer t storing the sink (reached, but never put in the next frontier)
+    CAP delta;          // CAP delta storing the smallest residual capacity the BFS may use
+    int *queue;         // BFS queue of the workspace, holding the levels one after the other
+    int levelStart, levelEnd; // the level being expanded is queue[levelStart .. levelEnd-1]
+    atomic_int rear;    // index of the next free entry of queue (threads reserve room for a whole buffer at once)
+    atomic_int cursor;  // index of the next chunk of work to be claimed by a thread
+    atomic_long nextArcs; // arcs leaving the vertices put in the next frontier
+    int task;           // task run by the threads in the current step (PBFS_TASK_*)
+    pthread_t *worker;
+    pthread_barrier_t barrier;
 
-}Queue; 
+}PARALLELBFS;
+
+typedef struct workspace {
+
+    /* Arrays used by every BFS of a solve, allocated once per solve by CreateWorkspace & reused, so that no BFS allocates.
+       A vertex v is visited by the current BFS when visited[v] == stamp, every BFS starts by incrementing stamp          */
+
+    int V;              // integer V storing the number of vertices the arrays are sized for
+    int *parent;        // parent[v] stores the arc through which the BFS reached v (-2 for the source)
+    CAP *bottleneck;    // bottleneck[v] stores the minimum residual capacity on the BFS path from the source to v
+    int *queue;         // array used as BFS queue (every vertex enters at most once, so V+1 entries suffice)
+    int *visited;       // visited[v] stores the stamp of the last BFS that reached v
+    int stamp;          // integer stamp storing the stamp of the current BFS
+    CAP delta;          // CAP delta storing the smallest residual capacity BFS may use (0 : every arc with residual capacity)
+    unsigned long long *frontier; // bitmap of the current BFS level, used by bottom-up steps (all bits clear between steps)
+    PARALLELBFS *P;     // pointer P storing the parallel BFS threads (NULL when Threads is 1, BFS is then sequential)
+
+}WORKSPACE;
+
+#ifdef MAXFLOW_STATS
+typedef struct solverstats {
+
+    /* Counters of the solver, summed over all solves of the run & printed as JSON on exit. Counters & times are updated
+       once per call with relaxed atomic adds, so that solves running on several threads (Gomory-Hu, the job pool) can
+       share them                                                                                                      */
+
+    atomic_long solves;           // integer solves storing the number of ComputeMaxFlow calls
+    atomic_long augmentingPaths;  // integer augmentingPaths storing the number of augmenting paths (Edmonds-Karp, Dinic, Boykov-Kolmogorov)
+    atomic_long pathArcs;         // integer pathArcs storing the total length of all augmenting paths
+    atomic_long bfsCalls;         // integer bfsCalls storing the number of BFS runs (BFS & Dinic level graphs)
+    atomic_long verticesDequeued; // integer verticesDequeued storing the number of vertices taken out of BFS queues
+    atomic_long arcsScanned;      // integer arcsScanned storing the number of arcs looked at by BFS runs & search tree growth
+    atomic_long bottomUpSteps;    // integer bottomUpSteps storing the number of BFS levels expanded bottom-up
+    atomic_long reverseArcs;      // integer reverseArcs storing the number of reverse arcs added to residual networks
+    atomic_long needEdges;        // integer needEdges storing the number of edges added for need based flow
+    atomic_long scalingAugment[SCALING_BUCKETS]; // scalingAugment[k] storing augmenting paths found in capacity scaling phases of bucket k
+    atomic_long residualTime;     // integer residualTime storing the wall time (nanoseconds) spent building residual networks in ComputeMaxFlow
+    atomic_long solveTime;        // integer solveTime storing the wall time (nanoseconds) spent in the solver engines called by ComputeMaxFlow
+    atomic_long writeBackTime;    // integer writeBackTime storing the wall time (nanoseconds) spent copying flow back to the edges
+    atomic_long needTime;         // integer needTime storing the wall time (nanoseconds) spent adding universal source & sink in NeedBasedFlow
+    atomic_long reduceVertices;   // integer reduceVertices storing the number of vertices given to ReduceGraph
+    atomic_long reduceVerticesKept; // integer reduceVerticesKept storing the number of vertices of reduced networks
+    atomic_long reduceEdges;      // integer reduceEdges storing the number of edges given to ReduceGraph
+    atomic_long reduceEdgesKept;  // integer reduceEdgesKept storing the number of arc pairs of reduced networks
+    atomic_long reduceTime;       // integer reduceTime storing the wall time (nanoseconds) spent reducing graphs & expanding flows back
+    atomic_long reorderTime;      // integer reorderTime storing the wall time (nanoseconds) spent reordering vertices of graphs
+    atomic_long matchingSolves;   // integer matchingSolves storing the number of solves done by HopcroftKarp
+    atomic_long matchingPhases;   // integer matchingPhases storing the number of HopcroftKarp phases (BFS + DFS rounds)
+
+}SOLVERSTATS;
+
+SOLVERSTATS Stats;                  // Counters of the solver instrumentation
+#endif
 
 /*------------------------------------------------------------------------------------------------------------------------------------------------*/
 /*----- Function Prototyping -----*/
 
-GRAPH *ReadGraph(char *fname);                        // Function to read graph
+GRAPH *ReadGraph(char *fname);                        // Function to read graph, stopping the program if it cannot be read
+GRAPH *LoadGraph(char *fname, char *error);           // Function to read graph, giving a message instead when it cannot be read
+GRAPH *ReadBinaryGraph(char *fname, char *data, size_t size, char *error); // Function to read graph from memory mapped binary file
+int CheckBinaryArrays(RESIDUAL *R);                   // Function to check the CSR arrays of a binary graph before they are used as indexes
+void WriteBinaryGraph(GRAPH *G, char *fname);         // Function to write graph in binary format
+void WriteTextGraph(GRAPH *G, char *fname);           // Function to write graph in text format
+int ScanInt(char **p, char *end, int *value);         // Function to read next integer from text
+int ScanLineInt(char **p, char *end, int *value);     // Function to read an integer if one follows on the same line
+int ScanCap(char **p, char *end, CAP *value);         // Function to read next capacity (or need) from text
+void ScanError(char *fname, char *data, char *at, int read, char *error); //Function to describe a number of a text graph that could not be read
+CAP NarrowCap(CAPWIDE value, char *what);             // Function to convert a sum of capacities to CAP, stopping if it does not fit
+int CheckCapTotals(GRAPH *G, char *fname, char *error); // Function to check that capacities & needs around every vertex add up within CAP
+int CapRaiseFits(GRAPH *G, int x, int y, CAP raise);  // Function to check that raising edge (x, y) keeps the sums around x & y within CAP
 void PrintGraph(GRAPH G);                             // Function to print graph's adjacency list
+int InternalId(GRAPH *G, int x);                      // Function to map a vertex id of the input file to the vertex of the graph
 void ComputeMaxFlow(GRAPH *G, int s, int t);          // Function to compute maximum flow for given graph, souce vertex & sink vertex
+CAP SolveMaxFlow(GRAPH *G, int s, int t);             // Function to compute maximum flow without printing it
+CAP BoundedMaxFlow(GRAPH *G, int s, int t, CAP *upper); // Function to compute a flow within the budget & an upper bound on the maximum
+void SetBudget(RESIDUAL *R);                          // Function to give a residual network the deadline & steps of -budget & -steps
+int BudgetSpent(RESIDUAL *R, int steps);              // Function to check the budget before an engine takes steps
+CAP CutBound(RESIDUAL *R, int s, int t);              // Function to find the cheapest s-t cut among the BFS layers of a residual network
 void NeedBasedFlow(GRAPH *G);                         // Function to compute need based flow for given graph
+int AddNeedEdges(GRAPH *G);                           // Function to add universal source & sink for need based flow
+COSTSUM MinCostCirculation(RESIDUAL *R);              // Function to turn a feasible flow into a minimum cost one (cost scaling)
+void MCFRefine(RESIDUAL *R, long long eps, long long scale, long long *price, CAP *excess, int *it, int *queue, char *queued);  // Function to make flow eps-optimal
 
-int BFS(int s,int t,GRAPH *G,int * parent);           // Function to perform Breadth First Traversal to find shortest augmenting path
+CAP BFS(int s,int t,RESIDUAL *R,WORKSPACE *W);       // Function to perform Breadth First Traversal to find shortest augmenting path
+WORKSPACE *CreateWorkspace(int V);                    // Function to allocate BFS arrays of a solve on V vertices
+int BFSDirection(int bottomUp, int V, int frontier, long frontierArcs, long unexploredArcs);  // Function to choose top-down or bottom-up for the next BFS level
+CAP ParallelBFS(int s, int t, RESIDUAL *R, WORKSPACE *W);  // Function to perform BFS with every level split across threads
+void PBFSRunTask(PARALLELBFS *P, int task);           // Function to run one step of the parallel BFS on all threads
+void *PBFSWorker(void *arg);                          // Thread function of the parallel BFS workers
+void PBFSTopDownTask(PARALLELBFS *P);                 // Task : expand claimed vertices of the level along their arcs
+void PBFSBottomUpTask(PARALLELBFS *P);                // Task : look for a parent in the level for claimed unvisited vertices
+void PBFSFlush(PARALLELBFS *P, int *buffer, int count); // Function to move a thread's next frontier buffer to the queue
+void FreeWorkspace(WORKSPACE *W);                     // Function to free BFS arrays of a solve
 int checkFeasibility(GRAPH *G);                       // Function to check feasibility of need based flow
 
-/*-----Queue Functions' Prototyping---*/
-Queue* createQueue(int capacity);                     //Function to create queue of specified capacity
-int isFull(Queue* queue);                             //Function to check whether queue is full or not
-int isEmpty(Queue* queue);                            //Function to check whether queue is empty or not
-void enqueue(Queue* queue, int item);                 //Function to insert element in queue 
-int dequeue(Queue* queue);                            //Function to delete & return front element of queue
-int front(Queue* queue) ;                             //Function to fetch front element in queue
+/*-----Solver Engines' Prototyping---*/
+CAP EdmondsKarp(RESIDUAL *R, int s, int t);           //Edmonds-Karp engine : one shortest augmenting path per BFS
+CAP Dinic(RESIDUAL *R, int s, int t);                 //Dinic engine : blocking flow on level graph per phase
+int DetectBipartite(GRAPH *G, int s, int t, char *side);  //Function to check whether a unit capacity graph is a bipartite matching network
+CAP HopcroftKarp(GRAPH *G, int s, char *side);      //Matching engine : Hopcroft-Karp phases on a bipartite unit capacity graph
+CAP CapacityScaling(RESIDUAL *R, int s, int t);       //Capacity scaling engine : Edmonds-Karp on arcs with residual capacity >= delta
+int DinicLevelGraph(RESIDUAL *R, int s, int t, int *level, int *queue, unsigned long long *frontier);  //Function to build level graph for Dinic engine
+CAP PushRelabel(RESIDUAL *R, int s, int t);          //Push-relabel engine : highest-label selection, gap & global relabel heuristics
+void PRGlobalRelabel(PUSHRELABEL *P);                 //Function to recompute exact heights by reverse BFS from the sink
+void PRDischarge(PUSHRELABEL *P, int v);              //Function to push excess of vertex v, relabelling it when needed
+void PRReturnExcess(PUSHRELABEL *P);                  //Function to return excess left after the first phase to the source
+CAP ParallelPushRelabel(RESIDUAL *R, int s, int t);  //Parallel push-relabel engine : lock-free discharge on Threads threads
+CAP CapFetchAdd(ATOMIC_CAP *p, CAP d);                //Function to add d to an atomic capacity & return its old value
+void PPRRunTask(PARALLELPR *P, int task);             //Function to run one task on all threads & wait for it to finish
+void *PPRWorker(void *arg);                           //Thread function of the parallel push-relabel workers
+void PPRDischargeTask(PARALLELPR *P);                 //Task : claim & discharge vertices of the active list
+void PPRExpandTask(PARALLELPR *P);                    //Task : expand one level of the global relabel BFS
+void PPRGlobalRelabel(PARALLELPR *P);                 //Function to recompute heights by parallel reverse BFS from t & s
+CAP BoykovKolmogorov(RESIDUAL *R, int s, int t);      //Boykov-Kolmogorov engine : source & sink search trees kept between augmentations
+BOYKOVKOLMOGOROV *BKCreate(RESIDUAL *R, int s, int t); //Function to allocate search trees holding only their roots s & t
+int BKGrow(RESIDUAL *R, BOYKOVKOLMOGOROV *B, int v);  //Function to grow the tree of v along its arcs until the other tree is met
+CAP BKAugment(RESIDUAL *R, BOYKOVKOLMOGOROV *B, int b);  //Function to push flow along the tree path through arc b & collect orphans
+void BKAdopt(RESIDUAL *R, BOYKOVKOLMOGOROV *B);       //Function to find new parents for orphans or free them
+void BKActivate(RESIDUAL *R, BOYKOVKOLMOGOROV *B, int v);  //Function to append a vertex to the active ring buffer & rewind its arcs
+void BKOrphan(BOYKOVKOLMOGOROV *B, int v);            //Function to append a vertex to the orphan ring buffer
+void BKMarkVertex(RESIDUAL *R, int v);                //Function to note a vertex whose arcs changed outside the engine
+void FreeSearchTrees(RESIDUAL *R);                    //Function to drop search trees kept in a residual network
+void ScalingBenchmark(GRAPH *G, int s, int t, int maxThreads);  //Function to time the parallel engine for 1 .. maxThreads threads
+double WallTime();                                    //Function to read monotonic clock in seconds
+CAP RunEngine(RESIDUAL *R, int s, int t, int engine); //Function to run given engine on residual network
+int ParseEngine(char *name);                          //Function to map engine name given on command line to engine id
+
+/*-----Gomory-Hu Tree Functions' Prototyping---*/
+CUTTREE *BuildCutTree(GRAPH *G);                      //Function to build Gomory-Hu tree of graph (edges taken as undirected)
+void *CutJob(void *arg);                              //Function to compute one minimum cut of the tree construction
+CAP CutTreeQuery(CUTTREE *T, int u, int v);           //Function to find maximum flow between u & v from the tree
+void FreeCutTree(CUTTREE *T);                         //Function to free Gomory-Hu tree
+
+/*-----Graph Reduction Functions' Prototyping---*/
+REDUCTION *ReduceGraph(GRAPH *G, int s, int t);       //Function to build the reduced network of a graph for an s-t solve
+int ReduceNode(REDUCTION *X, int kind, int left, int right, EDGE *leaf);  //Function to add a node to the reduction mapping
+void ExpandFlow(REDUCTION *X, GRAPH *G);              //Function to expand flow of the reduced network onto the edges of the graph
+void FreeReduction(REDUCTION *X);                     //Function to free reduced network & mapping
+
+/*-----Vertex Reordering Functions' Prototyping---*/
+void ReorderGraph(GRAPH *G, int method);              //Function to renumber vertices of a graph for memory locality
+int ParseReorder(char *name);                         //Function to map reordering name given on command line to REORDER_* value
+char *ReorderName(int method);                        //Function to map REORDER_* value to its command line name
+int CompareLong(const void *a, const void *b);        //Comparison function for qsort of long longs
+
+/*-----Batch Mode Functions' Prototyping---*/
+int RunBatch(BATCHJOB *job, int count, char *outFile);  //Function to run batch jobs writing all results through one buffered stream
+int ReadManifest(char *fname, BATCHJOB **job, int task, int output);  //Function to read batch jobs (file s t [task] [output]) from a manifest
+int RunBatchJob(BATCHJOB *job, FILE *out);            //Function to load the graph of a job & run its tasks
+void WriteBatchResult(FILE *out, GRAPH *G, RESIDUAL *R, BATCHJOB *job, int task, int s, int V, CAP value, int feasible);  //Function to write the result of one task
+void WriteBatchTime(FILE *out, BATCHJOB *job, double load, double max, double need);  //Function to write the timing line of a job
+void WriteBatchBound(FILE *out, BATCHJOB *job, CAP lower, CAP upper);  //Function to write the bounds line of a max flow solved within a budget
+void WriteMinCut(FILE *out, GRAPH *G, RESIDUAL *R, int s, int V);  //Function to write the edges of the minimum cut of a solved residual network
+CAP EdgeFlow(RESIDUAL *R, EDGE *p, int *a);           //Function to read the flow of an edge from the arcs of its start vertex
+int RunPool(BATCHJOB *job, int count, FILE *out);     //Function to run batch jobs concurrently on a work-stealing pool of Threads threads
+void *PoolWorker(void *arg);                          //Thread function of the job pool workers
+void PoolPush(POOLQUEUE *Q, int kind, int index);     //Function to push a task on the queue of a worker
+int PoolTake(JOBPOOL *P, int id, POOLTASK *task);     //Function to take a task from the own queue or steal one from another worker
+void PoolLoadFile(JOBPOOL *P, int f, POOLQUEUE *Q);   //Task : read a graph file, solve its need based flow & push its jobs
+void PoolSolveJob(JOBPOOL *P, int j);                 //Task : solve the tasks of one job on the shared graph of its file
+void PoolEmit(JOBPOOL *P, int j, char *text, size_t length);  //Function to write job outputs to the batch stream in job order
+int CompareJobFile(const void *a, const void *b);     //Comparison function for qsort of jobs by file name
+int ParseTask(char *name);                            //Function to map task name to TASK_* value
+int ParseOutput(char *name);                          //Function to map output name to OUTPUT_* value
+
+/*-----Benchmark Functions' Prototyping---*/
+void GenerateGraph(char *kind, int size, unsigned long long seed, char *fname);  //Function to write a synthetic instance in text format
+void AddGenEdge(EDGELIST *L, int x, int y, int c);    //Function to append an edge to a generator edge list
+int GenRandom(unsigned long long *state, int n);      //Function to draw a pseudo random integer in 0 .. n-1 (xorshift64*)
+void RunBenchmark(char *fname, int s, int t, int runs); //Function to time all phases over repeated runs & print JSON report
+void BenchmarkRun(char *fname, int s, int t, double *phase, int *result, CAP *flow);  //Function to run all phases once (in a child process)
+void PrintPhaseStats(char *name, double *sample, int runs, int last);  //Function to print JSON statistics of one phase
+int CompareDouble(const void *a, const void *b);      //Comparison function for qsort of doubles
+char *EngineName(int engine);                         //Function to map engine id to its command line name
+
+/*-----Capacity Update Functions' Prototyping---*/
+int UpdateCapacities(GRAPH *G, int s, int t, CAPUPDATE *update, int count);  //Function to change capacities of a solved graph & repair its flow
+CAP RepairFlow(RESIDUAL *R, int from, int to, CAP amount, int *parent, int *queue, int *mark, int *stamp);  //Function to move flow along residual paths
+int ReadUpdates(char *fname, CAPUPDATE **update);     //Function to read capacity updates (x y c per line) from file
+void ResetFlow(GRAPH *G);                             //Function to set flow of every edge to zero
+CAP FlowValue(RESIDUAL *R, int s);                    //Function to compute net flow leaving s
+
+/*-----Residual Network Functions' Prototyping---*/
+RESIDUAL *BuildResidual(GRAPH *G);                    //Function to build CSR residual network (with paired reverse arcs) of graph
+void WriteBackFlow(RESIDUAL *R);                      //Function to copy flow on forward arcs back to EDGE::f
+void ReadBackFlow(RESIDUAL *R);                       //Function to copy EDGE::f onto forward arcs (& their reverse arcs)
+void PushArc(RESIDUAL *R, int a, CAP d);              //Function to push d units of flow on arc a (& its reverse arc)
+void FreeResidual(RESIDUAL *R);                       //Function to free residual network
+
+/*-----Arena Functions' Prototyping---*/
+ARENA *NewArena();                                    //Function to take an arena from the pool (or create one)
+void *ArenaAlloc(ARENA *A, size_t bytes);             //Function to allocate memory from an arena
+void *ArenaCalloc(ARENA *A, size_t count, size_t size); //Function to allocate zeroed memory from an arena
+void ReleaseArena(ARENA *A);                          //Function to release all memory of an arena & return it to the pool
+void DestroyGraph(GRAPH *G);                          //Function to release a graph, its edges & its residual network
+
+#ifdef MAXFLOW_STATS
+/*-----Instrumentation Functions' Prototyping---*/
+void PrintStats();                                    //Function to print counters of the solver as JSON on stderr
+#endif
 
 /*------------------------------------------------------------------------------------------------------------------------------------------------*/
 /*----- Main Driver Function -----*/
         
-int main(){
+int main(int argc, char *argv[]){
 	
 	GRAPH *myGraph1,*myGraph2;
+    STAT(atexit(PrintStats);)
+
+    int scale = 0;
+    char *updateFile = NULL;
+    char *queryFile = NULL;
+    char *benchFile = NULL;
+    int benchSource = 0, benchSink = 0, benchRuns = 0;
+    char *manifestFile = NULL, *outFile = NULL;
+    BATCHJOB run = {NULL, 0, 0, TASK_BOTH, OUTPUT_VALUE};
+    for(int i=1;i<argc;i++){
+        if(strcmp(argv[i],"-e")==0 && i+1<argc){     Engine = ParseEngine(argv[++i]); EngineChosen = 1; }
+        else if(strcmp(argv[i],"-t")==0 && i+1<argc) Threads = atoi(argv[++i]) > 0 ? atoi(argv[i]) : 1;
+        else if(strcmp(argv[i],"-scale")==0)         scale = 1;
+        else if(strcmp(argv[i],"-reduce")==0)        Reduce = 1;
+        else if(strcmp(argv[i],"-reorder")==0 && i+1<argc) Reorder = ParseReorder(argv[++i]);
+        else if(strcmp(argv[i],"-budget")==0 && i+1<argc)  Budget = atof(argv[++i])/1000;
+        else if(strcmp(argv[i],"-steps")==0 && i+1<argc)   StepBudget = atol(argv[++i]);
+        else if(strcmp(argv[i],"-update")==0 && i+1<argc) updateFile = argv[++i];
+        else if(strcmp(argv[i],"-gomory-hu")==0 && i+1<argc) queryFile = argv[++i];
+        else if((strcmp(argv[i],"-to-binary")==0 || strcmp(argv[i],"-to-text")==0) && i+2<argc){
+            GRAPH *G = ReadGraph(argv[i+1]);                //Convert between text & binary graph formats
+            if(argv[i][4]=='b') WriteBinaryGraph(G,argv[i+2]);
+            else                WriteTextGraph(G,argv[i+2]);
+            DestroyGraph(G);
+            return 0;
+        }
+        else if(strcmp(argv[i],"-generate")==0 && i+4<argc){
+            GenerateGraph(argv[i+1], atoi(argv[i+2]), strtoull(argv[i+3],NULL,10), argv[i+4]);
+            return 0;
+        }
+        else if(strcmp(argv[i],"-bench")==0 && i+4<argc){
+            benchFile   = argv[i+1];
+            benchSource = atoi(argv[i+2]);
+            benchSink   = atoi(argv[i+3]);
+            benchRuns   = atoi(argv[i+4]) > 0 ? atoi(argv[i+4]) : 1;
+            i += 4;
+        }
+        else if(strcmp(argv[i],"-run")==0 && i+3<argc){
+            run.file = argv[i+1];
+            run.s    = atoi(argv[i+2]);
+            run.t    = atoi(argv[i+3]);
+            i += 3;
+        }
+        else if(strcmp(argv[i],"-manifest")==0 && i+1<argc) manifestFile = argv[++i];
+        else if(strcmp(argv[i],"-task")==0 && i+1<argc)     run.task = ParseTask(argv[++i]);
+        else if(strcmp(argv[i],"-out")==0 && i+1<argc)      run.output = ParseOutput(argv[++i]);
+        else if(strcmp(argv[i],"-o")==0 && i+1<argc)        outFile = argv[++i];
+    }
 
-    char S[20];
+    if(run.file != NULL || manifestFile != NULL){
+        //Non interactive, nothing is prompted & the graph of every job is read once
+        BATCHJOB *job = &run;
+        int count = 1;
+        if(manifestFile != NULL) count = ReadManifest(manifestFile,&job,run.task,run.output);
+        int failed = RunBatch(job,count,outFile);
+        if(job != &run){
+            for(int i=0;i<count;i++) free(job[i].file);
+            free(job);
+        }
+        return failed > 0;                          //Scripts see a failed job in the exit status
+    }
+
+    if(benchFile != NULL){
+        RunBenchmark(benchFile,benchSource,benchSink,benchRuns);  //Non interactive, runs after all options are known
+        return 0;
+    }
+
+    char S[4096];
     int source,sink;
 
     printf("Please Enter File Name: ");
-    scanf("%s",&S);
+    scanf("%4095s",S);
     myGraph1 = ReadGraph(S);
+    ReorderGraph(myGraph1,Reorder);   //Ids typed in & printed stay those of the file
 	PrintGraph(*myGraph1);   
 
+    if(queryFile != NULL){
+        //All pairs minimum cuts : build the tree once, then answer (u, v) queries from file
+        CUTTREE *T = BuildCutTree(myGraph1);
+        printf("\nGomory-Hu Tree (vertex - parent : maximum flow) :- \n\n");
+        for(int x=1;x<=T->V;x++){
+            int v = InternalId(myGraph1,x);
+            if(v != 1) printf("%d - %d : " CAP_FMT "\n", x, myGraph1->H[T->parent[v]].x, T->weight[v]);  //Vertex 1 is the root
+        }
+
+        FILE *fptr = fopen(queryFile, "r");
+        if (fptr == NULL){
+            printf("Could not open file %s.\n",queryFile);
+            exit(0);
+        }
+        int u,v;
+        printf("\n");
+        while(fscanf(fptr,"%d %d",&u,&v) == 2){
+            if(u < 1 || u > T->V || v < 1 || v > T->V || u == v) continue;
+            printf("The maximum flow between %d and %d is " CAP_FMT ".\n", u, v, CutTreeQuery(T,InternalId(myGraph1,u),InternalId(myGraph1,v)));
+        }
+        fclose(fptr);
+        FreeCutTree(T);
+        DestroyGraph(myGraph1);
+        return 0;
+    }
+
     printf("Please Enter id of Source Node: ");
     scanf("%d",&source);
     printf("Please Enter id of Sink Node: ");
     scanf("%d",&sink);
+    source = InternalId(myGraph1,source);
+    sink   = InternalId(myGraph1,sink);
+
+    if(scale){
+        ScalingBenchmark(myGraph1,source,sink,Threads);  //Only time the parallel engine
+        DestroyGraph(myGraph1);
+        return 0;
+    }
 
     printf("\nAssignment Part 1 : Compute Max Flow \n");
 	ComputeMaxFlow(myGraph1,source,sink);
     PrintGraph(*myGraph1);
 
+    if(updateFile != NULL){
+        //Change capacities of the solved graph & continue from its flow
+        CAPUPDATE *update;
+        int count = ReadUpdates(updateFile,&update);
+        printf("\nCapacity Updates : %d edges changed\n", UpdateCapacities(myGraph1,source,sink,update,count));
+        ComputeMaxFlow(myGraph1,source,sink);
+        PrintGraph(*myGraph1);
+        free(update);
+    }
+
     printf("\nAssignment Part 2 : Need Based Flow \n");
-    myGraph2 = ReadGraph(S);          
+    myGraph2 = myGraph1;              //Reuse the graph loaded above, starting again from zero flow
+    ResetFlow(myGraph2);
     NeedBasedFlow(myGraph2);
     //Print graph only if need based flow is feasible
     if(checkFeasibility(myGraph2)) PrintGraph(*myGraph2);
     else                            printf("\nNo Need Based Flow Exists.\n\n"); // Graph is not printed
+    DestroyGraph(myGraph2);
     return 0;
 }
 /*------------------------------------------------------------------------------------------------------------------------------------------------*/
@@ -106,216 +832,649 @@ GRAPH *ReadGraph(char *fname){
 
     /*
      * Arguments      : Character pointer to File Name
-     * Task Performed : Initialises number of vertices & number of edges of Graph myGraph
-     *                  Creats an adjacenty list (adjList) & stores graph edges in it
-     * Returns        : Pointer to myGraph                 
+     * Task Performed : Reads the graph with LoadGraph & stops the program with its message when the file cannot be read
+     * Returns        : Pointer to the graph
     */
-    
-    FILE *fptr;
-    fptr = fopen(fname, "r");
-    
-    if (fptr == NULL){
-        printf("Could not open file %s.\n",fname);
+
+    char error[LOAD_ERROR];
+    GRAPH *G = LoadGraph(fname, error);
+    if(G == NULL){
+        printf("%s\n", error);
         exit(0);
     }
-    else{
+    return G;
+}
 
-        GRAPH *myGraph = (GRAPH *)malloc(sizeof(GRAPH));
-        
-        fscanf(fptr,"%d",&myGraph->V); //Initialise number of vertices in graph
-        fscanf(fptr,"%d",&myGraph->E); //Initialise number of edges in graph
-        
-        VERTEX *H = (VERTEX *)malloc((myGraph->V+1)*sizeof(VERTEX));		
-		EDGE **adjList = (EDGE **)malloc((myGraph->E+1)*sizeof(EDGE*));
+GRAPH *LoadGraph(char *fname, char *error){
 
-        for(int i=0;i<=myGraph->E;i++){
-        	adjList[i]=NULL;			//Initializing array of pointers with NULL
+    /*
+     * Arguments      : Character pointer to File Name, buffer of LOAD_ERROR characters for the message
+     * Task Performed : 1) Memory maps the file read only, a file starting with BINARY_MAGIC is made writable (private
+     *                     copy on write) & handed over to ReadBinaryGraph
+     *                  2) Reads V, E, need of every vertex & the E edges (x, y, c [w]) in one pass with ScanInt & ScanCap,
+     *                     an edge line may end with the cost w per unit of flow (0 if omitted)
+     *                  3) Sorts edges by (x, y) with two counting sort passes & merges parallel edges of equal cost by adding capacities
+     *                  4) Stores the merged edges in one EDGE block, linked into the adjacency list of their start vertex
+     *                  The graph, its vertices & its edges are allocated from one arena, released by DestroyGraph
+     * Returns        : Pointer to myGraph (myGraph->E is the number of edges after merging), NULL with the reason in
+     *                  error when the file cannot be opened or read (nothing is left allocated then)
+     * NOTE           : Edges with an endpoint outside 1 .. V are ignored. Files with a token that is not a number, with
+     *                  V < 1 or E < 0, ids beyond int, numbers beyond the range of CAP & graphs whose flows could overflow
+     *                  CAP (see CheckCapTotals) are refused
+    */
+
+    int fd = open(fname, O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd,&st) < 0 || st.st_size == 0){
+        if(fd >= 0) close(fd);
+        snprintf(error, LOAD_ERROR, "Could not open file %s.", fname);
+        return NULL;
+    }
+
+    size_t size = st.st_size;
+    char *data = (char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED){
+        snprintf(error, LOAD_ERROR, "Could not open file %s.", fname);
+        return NULL;
+    }
+
+    if(size >= BINARY_HEADER*sizeof(int) && *(int *)data == BINARY_MAGIC){
+        //The residual network lives in the mapping & -update changes its capacities (private copy)
+        if(mprotect(data, size, PROT_READ | PROT_WRITE) != 0){
+            snprintf(error, LOAD_ERROR, "Could not map binary graph %s.", fname);
+            munmap(data, size);
+            return NULL;
         }
-        
-        for(int i=1;i<=myGraph->V;i++){
-            H[i].x=i;                             // Start Vertex of Edge
-            fscanf(fptr,"%d",&H[i].n);            // Need of Vertex
-            H[i].p=NULL;                          // Initialises pointer to array of neighbour nodes with NULL
-        }        
-    
-        //Filling Adjacency List
-        for(int i=0;i<myGraph->E;i++){
-            
-            EDGE *temp,*p;
-            temp = (EDGE*)malloc(sizeof(EDGE));
-            int x;
-            fscanf(fptr,"%d",&x);         //Read x
-            fscanf(fptr,"%d",&(temp->y)); //Read y
-            fscanf(fptr,"%d",&(temp->c)); //Read c
-            
-            temp->f=0;
-            temp->next=NULL;
+        return ReadBinaryGraph(fname, data, size, error);
+    }
 
-            if(adjList[x]==NULL) adjList[x]=temp;
-            else{
+    char *p = data, *end = data + size;
+    int V = 0, E = 0, read;
+    if((read = ScanInt(&p,end,&V)) == 1) read = ScanInt(&p,end,&E);    //Number of vertices & edges in graph
+    if(read != 1){
+        ScanError(fname, data, p, read, error);
+        munmap(data, size);
+        return NULL;
+    }
+    //Every need takes at least 2 characters & every edge at least 6, so sizes are checked before anything is allocated
+    if(V < 1 || E < 0 || (size_t)V > size/2 || (size_t)E > size/6){
+        snprintf(error, LOAD_ERROR, "Graph file %s : %d vertices & %d edges are not valid for a file of %zu bytes.", fname, V, E, size);
+        munmap(data, size);
+        return NULL;
+    }
 
-                p=adjList[x];
-                if(p->y == temp->y){
-                    p->c = p->c + temp->c;           //Increase capacity if edge already exists
-                    continue;
-                }
+    ARENA *arena = NewArena();
+    GRAPH *myGraph = (GRAPH *)ArenaAlloc(arena, sizeof(GRAPH));
+    myGraph->R = NULL;
+    myGraph->rank = NULL;
+    myGraph->arena = arena;
 
-                int flag=0;
-                while(p->next!=NULL){
-                    
-                    if(p->y == temp->y){
-                        p->c = p->c + temp->c;        //Merge paralled edge if an edge already exists
-                        flag=1;
-                        break;
-                    }
-                    p=p->next;
-                }
+    VERTEX *H = (VERTEX *)ArenaAlloc(arena, ((size_t)V+1)*sizeof(VERTEX));
+    for(int i=1;i<=V && read == 1;i++){
+        H[i].x=i;                             // Start Vertex of Edge
+        read = ScanCap(&p,end,&H[i].n);       // Need of Vertex
+        H[i].p=NULL;                          // Initialises pointer to array of neighbour nodes with NULL
+    }
+
+    //Read edges
+    int *ex = (int *)malloc(((size_t)E+1)*sizeof(int));
+    int *ey = (int *)malloc(((size_t)E+1)*sizeof(int));
+    CAP *ec = (CAP *)malloc(((size_t)E+1)*sizeof(CAP));
+    int *ew = (int *)malloc(((size_t)E+1)*sizeof(int));
+    int m = 0, costed = 0;
+    for(int i=0;i<E && read == 1;i++){
+        if((read = ScanInt(&p,end,&ex[m])) != 1) break;       //Read x
+        if((read = ScanInt(&p,end,&ey[m])) != 1) break;       //Read y
+        if((read = ScanCap(&p,end,&ec[m])) != 1) break;       //Read c
+        if((read = ScanLineInt(&p,end,&ew[m])) != 1) break;   //Read optional w (0 if the line ends)
+        if(ew[m] != 0) costed = 1;
+        if(ex[m] >= 1 && ex[m] <= V && ey[m] >= 1 && ey[m] <= V) m++;
+    }
+    if(read != 1){
+        ScanError(fname, data, p, read, error);
+        munmap(data, size);
+        free(ex);
+        free(ey);
+        free(ec);
+        free(ew);
+        ReleaseArena(arena);
+        return NULL;
+    }
+    munmap(data, size);
 
-                if(flag) p->next=NULL;
-                else     p->next=temp;
+    //Counting sort by y, then stable counting sort by x gives edges sorted by (x, y)
+    int *count = (int *)malloc(((size_t)V+2)*sizeof(int));
+    int *order = (int *)malloc(((size_t)m+1)*sizeof(int));
+    int *sorted = (int *)malloc(((size_t)m+1)*sizeof(int));
+
+    for(int i=0;i<=V+1;i++) count[i]=0;
+    for(int i=0;i<m;i++) count[ey[i]+1]++;
+    for(int i=1;i<=V+1;i++) count[i] += count[i-1];
+    for(int i=0;i<m;i++) order[count[ey[i]]++] = i;
+
+    for(int i=0;i<=V+1;i++) count[i]=0;
+    for(int i=0;i<m;i++) count[ex[i]+1]++;
+    for(int i=1;i<=V+1;i++) count[i] += count[i-1];
+    for(int i=0;i<m;i++) sorted[count[ex[order[i]]]++] = order[i];
+
+    //Merge parallel edges (now adjacent) & fill the EDGE block
+    //Every merged edge needs a block slot, so the block is sized by m & the unused tail is left in the arena
+    EDGE *block = (EDGE *)ArenaAlloc(arena, ((size_t)m+1)*sizeof(EDGE));
+    int merged = 0, unit = 1, tooLarge = 0;
+    for(int i=0;i<m && !tooLarge;i++){
+        int k = sorted[i];
+        if(merged > 0 && ex[sorted[i-1]] == ex[k] && block[merged-1].y == ey[k] && block[merged-1].w == ew[k]){
+            CAPWIDE sum = (CAPWIDE)block[merged-1].c + ec[k];   //Merge parallel edge if an edge already exists
+            if(sum > CAP_MAX){
+                snprintf(error, LOAD_ERROR, "The capacity of merged parallel edges %d -> %d of %s is beyond the range of the capacity type, rebuild with -DCAP_INT64 or -DCAP_DOUBLE.", ex[k], ey[k], fname);
+                tooLarge = 1;
             }
-        }  
-        
-        for(int i=1;i<=myGraph->E;i++){
-            H[i].p=adjList[i]; 
-        } 
-
-        myGraph->H=H;
-       
-        return myGraph;
-    }  
-} 
-/*------------------------------------------------------------------------------------------------------------------------------------------------*/
-/*----- Print Graph Function -----*/
+            else block[merged-1].c = (CAP)sum;
+            continue;
+        }
+        block[merged].y = ey[k];
+        block[merged].c = ec[k];
+        block[merged].f = 0;
+        block[merged].w = ew[k];
+        block[merged].next = NULL;
+        if(H[ex[k]].p == NULL) H[ex[k]].p = &block[merged];      //First edge of vertex x
+        else                   block[merged-1].next = &block[merged];
+        merged++;
+    }
+
+    for(int i=0;i<merged && unit;i++) unit = CAP_UNIT(block[i].c);   //Capacities are final once parallel edges are merged
+
+    free(ex);
+    free(ey);
+    free(ec);
+    free(ew);
+    free(count);
+    free(order);
+    free(sorted);
+
+    myGraph->V=V;
+    myGraph->E=merged;
+    myGraph->W=costed;
+    myGraph->U=unit;
+    myGraph->H=H;
+    if(tooLarge || !CheckCapTotals(myGraph, fname, error)){
+        DestroyGraph(myGraph);
+        return NULL;
+    }
+
+    return myGraph;
+}
+
+int ScanInt(char **p, char *end, int *value){
 
-void PrintGraph(GRAPH G){
-    
     /*
-     * Arguments      : Graph G
-     * Task Performed : Prints adjacenty list of Graph G in the following format
-     *                  V1 -> (V2,c2,f2) -> (V3,c3,f3)
-     *                  V2 
-     *                  V3
-     *                  The above network has 2 edges : One from V1 to V2 with capacity c2 & flow f2 
-     *                  and another one from V1 to V3 with capacity c3 & flow f3                      
-     * Returns        : void                 
+     * Arguments      : Pointer to read position in text, end of text, pointer to integer to fill
+     * Task Performed : Skips blanks & line ends, then reads a decimal integer (optionally signed) & advances the read position
+     * Returns        : 1 if an integer was read, 0 if the text ends first or the next token is not an integer, -1 if it
+     *                  does not fit in int (the read position is then left at the start of the token)
     */
 
-	printf("\nThe Graph is:- \n\n");
-	
-    VERTEX * H = G.H;
-	for(int i=1;i<=G.V;i++){
-		
-		printf("%d", i);
-		EDGE * pointer =H[i].p;
-        
-		while(pointer!=NULL){
+    char *q = *p;
+    while(q < end && TEXT_SPACE(*q)) q++;
+    *p = q;
 
-			if(pointer->c > 0) printf(" -> (%d,%d,%d) ",pointer->y,pointer->c,pointer->f);	//Print edges with positive capacities
-			pointer=pointer->next;
-		}
+    int sign = 1;
+    if(q < end && *q == '-'){
+        sign = -1;
+        q++;
+    }
+    if(q == end || *q < '0' || *q > '9') return 0;
 
-		printf("\n");
-	}
-	printf("\n");
+    long long number = 0;
+    while(q < end && *q >= '0' && *q <= '9'){
+        number = number*10 + (*q - '0');
+        if(number > INT_MAX) return -1;
+        q++;
+    }
+    if(q < end && !TEXT_SPACE(*q)) return 0;    //Like 12abc
+
+    *p = q;
+    *value = (int)(sign*number);
+    return 1;
 }
 
-/*------------------------------------------------------------------------------------------------------------------------------------------------*/
-/*----- Compute Max Flow Function -----*/
+int ScanCap(char **p, char *end, CAP *value){
 
-void ComputeMaxFlow(GRAPH *G, int s, int t){
-    
-    /* 
-     * Based on       : Ford-Fulkerson Method
-     * Arguments      : Pointer to Graph, source vertex : s, sink vertex : t
-     * Task Performed : 1) Add reverse edges with capacity =0 (if applicable)
-     *                  2) Finds shortest augmenting path with maximum residual capacity (among shortest paths) using function BFS, 
-     *                  3) Stores augmenting path using a parent array where parent[i] is parent of vertex i, 
-     *                     A vertex j with no parent has parent [j]= -1
-     *                  4) To find the augmenting path, we backtrack till source vertex using parent array
-     *                  5) Stores flow obtained from BFS function in var newFlow
-     *                  6) Increases maxFlow in each iteration till there exists an augmenting path by amount = newFlow
-     *                  7) Prints maximum flow for given network, source & sink vertex                  
-     * Returns        : void                 
+    /*
+     * Arguments      : Pointer to read position in text, end of text, pointer to capacity to fill
+     * Task Performed : Reads the next number like ScanInt, but into the capacity type, with an optional fraction & exponent
+     *                  for floating point builds
+     * Returns        : 1 if a number was read, 0 if the text ends first or the next token is not a number, -1 if it does
+     *                  not fit in CAP (the read position is then left at the start of the token)
     */
 
-   //Add reverse flow edges with capacity 0
+    char *q = *p;
+    while(q < end && TEXT_SPACE(*q)) q++;
+    *p = q;
 
-    VERTEX * H = G->H;
-	for(int i=1;i<=G->V;i++){
-		
-		EDGE * pointer =H[i].p;   
-        int x = i;
+    int sign = 1;
+    if(q < end && *q == '-'){
+        sign = -1;
+        q++;
+    }
 
-		while(pointer!=NULL){
+#ifdef CAP_DOUBLE
+    double number = 0, scale = 1;
+    int digits = 0;
+    for(;q < end && *q >= '0' && *q <= '9';digits++) number = number*10 + (*q++ - '0');
+    if(q < end && *q == '.'){
+        q++;
+        for(;q < end && *q >= '0' && *q <= '9';digits++){
+            scale /= 10;
+            number += (*q++ - '0')*scale;
+        }
+    }
+    if(digits == 0) return 0;
+    if(q < end && (*q == 'e' || *q == 'E')){
+        q++;
+        int expSign = 1, exponent = 0;
+        if(q < end && (*q == '-' || *q == '+')) expSign = *q++ == '-' ? -1 : 1;
+        if(q == end || *q < '0' || *q > '9') return 0;
+        while(q < end && *q >= '0' && *q <= '9'){
+            exponent = exponent*10 + (*q++ - '0');
+            if(exponent >= 1000) return -1;         //Far beyond DBL_MAX & DBL_MIN
+        }
+        for(int i=0;i<exponent;i++) number = expSign > 0 ? number*10 : number/10;
+    }
+    if(!(number <= CAP_MAX)) return -1;
+#else
+    if(q == end || *q < '0' || *q > '9') return 0;
+    long long number = 0;
+    while(q < end && *q >= '0' && *q <= '9'){
+        if(number > (CAP_MAX - (*q - '0'))/10) return -1;
+        number = number*10 + (*q - '0');
+        q++;
+    }
+#endif
+    if(q < end && !TEXT_SPACE(*q)) return 0;
 
-			int y = pointer->y;
-            if(pointer->c == 0) {
-                pointer=pointer->next;  // To avoid redundant edges
-                continue;
-            }
+    *p = q;
+    *value = (CAP)(sign*number);
+    return 1;
+}
 
-            EDGE * reverseEdge = (EDGE*)malloc(sizeof(EDGE));
-            reverseEdge->y=x;
-            reverseEdge->c=0;
-            reverseEdge->f=0;
-            reverseEdge->next=NULL;          
+void ScanError(char *fname, char *data, char *at, int read, char *error){
 
-            if(H[y].p==NULL) H[y].p=reverseEdge;
-            else{
-                    EDGE * pointer_new =H[y].p;
-                    int flag=0;
-                    
-                    while (pointer_new->next!=NULL)
-                    {
-                        if(pointer_new->y == x) {       //Reverse edge exists
-                            flag=1;
-                            break;
-                        }
-                        pointer_new = pointer_new->next;
-                    }
+    /*
+     * Arguments      : Character pointer to File Name, text of the file, read position of the number that failed, what
+     *                  ScanInt, ScanCap or ScanLineInt returned, buffer of LOAD_ERROR characters for the message
+     * Task Performed : Writes into error which line of the file holds the token that is not a number or is out of range
+     * Returns        : void
+    */
 
-                    if(flag == 0) pointer_new->next =  reverseEdge;       //Reverse edge does not exist, add one with capacity = 0                 
-            }
-          
-          	pointer=pointer->next;
-		}
+    int line = 1;
+    for(char *q=data;q<at;q++) line += *q == '\n';
+    if(read == 0) snprintf(error, LOAD_ERROR, "Graph file %s : expected a number at line %d.", fname, line);
+    else snprintf(error, LOAD_ERROR, "Graph file %s : the number at line %d is beyond the range of its type (ids must fit in int, "
+                  "capacities & needs in the capacity type : rebuild with -DCAP_INT64 or -DCAP_DOUBLE).", fname, line);
+}
+
+CAP NarrowCap(CAPWIDE value, char *what){
+
+    /*
+     * Arguments      : Sum of capacities or flows, what the sum is (for the message)
+     * Task Performed : Stops the program with a message when value does not fit in CAP
+     * Returns        : value as CAP
+    */
+
+    if(value > CAP_MAX || value < -(CAPWIDE)CAP_MAX){
+        printf("%s is beyond the range of the capacity type, rebuild with -DCAP_INT64 or -DCAP_DOUBLE.\n", what);
+        exit(0);
     }
+    return (CAP)value;
+}
 
-    
-   int maxFlow=0;
-   int newFlow=0; 
-   int * parent = (int*)malloc((G->V + 1)*sizeof(int));
+int CheckCapTotals(GRAPH *G, char *fname, char *error){
 
-   while(newFlow = BFS(s,t,G,parent)){
-        
-        maxFlow = maxFlow + newFlow;
-        int cur = t;
-        
-        while (cur != s) {   //Backtrack till soucrce vertex is found
+    /*
+     * Arguments      : Pointer to Graph, character pointer to File Name, buffer of LOAD_ERROR characters for the message
+     * Task Performed : Adds up, in CAPWIDE, the capacities leaving & entering every vertex plus its need (the need based flow
+     *                  links it to S or T), & the positive & negative needs (capacities leaving S & entering T). Any flow,
+     *                  excess or flow value an engine sums up is bounded by one of these, so when all fit in CAP no solve
+     *                  can overflow
+     * Returns        : 1 if all fit in CAP, 0 with the reason in error if not
+    */
 
-            int prev = parent[cur];            
-            EDGE * pointer = G->H[prev].p;
+    CAPWIDE *in = (CAPWIDE *)calloc(G->V + 1, sizeof(CAPWIDE));
+    CAPWIDE supply = 0, demand = 0;
+    int bad = 0;
 
-            while (pointer->y != cur) pointer=pointer->next;
-            pointer->f = pointer->f + newFlow;                //Update flow of all edges in augmenting path
-    
-            pointer = G->H[cur].p;
-            while (pointer->y != prev) pointer=pointer->next;
-            pointer->f = pointer->f - newFlow;
-    
-            cur = prev;
+    for(int v=1;v<=G->V && !bad;v++){
+        CAPWIDE out = G->H[v].n < 0 ? -(CAPWIDE)G->H[v].n : G->H[v].n;
+        in[v] += out;
+        if(G->H[v].n > 0) supply += G->H[v].n;
+        else              demand -= G->H[v].n;
+        for(EDGE *p = G->H[v].p; p!=NULL; p=p->next){
+            out += p->c;
+            in[p->y] += p->c;
         }
-   }
-  
-   printf("\nThe maximum amount of integal flow that can flow from Source (id -> %d) to Sink (id -> %d) is %d.\n", s,t,maxFlow);
+        if(out > CAP_MAX) bad = v;
+    }
+    for(int v=1;v<=G->V && !bad;v++) if(in[v] > CAP_MAX) bad = v;
+    free(in);
 
-   /*   
-        // To check existence of Need Based Flow and print message accordingly
+    if(bad){
+        snprintf(error, LOAD_ERROR, "The capacities around vertex %d of %s add up beyond the range of the capacity type, rebuild with -DCAP_INT64 or -DCAP_DOUBLE.", G->H[bad].x, fname);
+        return 0;
+    }
+    if(supply > CAP_MAX || demand > CAP_MAX){
+        snprintf(error, LOAD_ERROR, "The needs of %s add up beyond the range of the capacity type, rebuild with -DCAP_INT64 or -DCAP_DOUBLE.", fname);
+        return 0;
+    }
+    return 1;
+}
 
-        //Net need should be zero, sigma n[i]=0 is a neccesary condition for flow to exist.
-	    int net_need=0,flag=0;
-	    for(int i=1;i<=G->V;i++) net_need += G->H[i].n;
+int CapRaiseFits(GRAPH *G, int x, int y, CAP raise){
+
+    /*
+     * Arguments      : Pointer to Graph with residual network, vertices x & y of an edge, amount its capacity is raised by
+     * Task Performed : Checks the bound of CheckCapTotals for the capacities leaving x & entering y after the raise (every
+     *                  arc entering a vertex is the reverse of one of its own arcs)
+     * Returns        : 1 if both still fit in CAP, 0 if not
+    */
+
+    RESIDUAL *R = G->R;
+    CAPWIDE out = (CAPWIDE)raise + (G->H[x].n < 0 ? -(CAPWIDE)G->H[x].n : G->H[x].n);
+    CAPWIDE in  = (CAPWIDE)raise + (G->H[y].n < 0 ? -(CAPWIDE)G->H[y].n : G->H[y].n);
+    for(int a=R->first[x]; a<R->first[x+1]; a++) out += R->cap[a];
+    for(int a=R->first[y]; a<R->first[y+1]; a++) in += R->cap[R->rev[a]];
+    return out <= CAP_MAX && in <= CAP_MAX;
+}
+
+int ScanLineInt(char **p, char *end, int *value){
+
+    /*
+     * Arguments      : Pointer to read position in text, end of text, pointer to integer to fill
+     * Task Performed : Skips blanks but not the end of the line, reads an integer with ScanInt if one follows on the same line
+     * Returns        : 1 if an integer was read or the line ended first (value is then 0 & the read position is left at the
+     *                  line end), otherwise what ScanInt returned
+    */
+
+    char *q = *p;
+    while(q < end && (*q == ' ' || *q == '\t' || *q == '\r')) q++;
+    *p = q;
+    if(q == end || *q == '\n'){
+        *value = 0;
+        return 1;
+    }
+    return ScanInt(p,end,value);
+}
+
+GRAPH *ReadBinaryGraph(char *fname, char *data, size_t size, char *error){
+
+    /*
+     * Arguments      : Character pointer to File Name, memory mapped file contents & their size, buffer of LOAD_ERROR
+     *                  characters for the message
+     * Task Performed : 1) Checks the header (BINARY_MAGIC, BINARY_VERSION, CAP_CODE, V, E, A) & the file size, files written
+     *                     by a build with another capacity type are refused
+     *                  2) Points first, head, cap & rev of the residual network of the graph straight into the mapping (zero copy),
+     *                     the mapping stays alive until the residual network is freed. Files whose arrays are not
+     *                     consistent (CheckBinaryArrays) are refused
+     *                  3) Creates the EDGE block & adjacency lists from the forward arcs (arcs with positive capacity)
+     * Returns        : Pointer to myGraph with myGraph->R already built, NULL with the reason in error when the file is
+     *                  refused (the mapping is released then)
+     * NOTE           : The binary format stores no edge costs, every edge gets cost 0
+    */
+
+    int *header = (int *)data;
+    int V = header[3], E = header[4], A = header[5];
+
+    if(header[1] != BINARY_VERSION || V < 0 || A < 0 || E < 0 || E > A ||
+       size < BINARY_HEADER*sizeof(int) + ((size_t)V + 1 + (size_t)A)*sizeof(CAP) + ((size_t)V + 2 + 2*(size_t)A)*sizeof(int)){
+        snprintf(error, LOAD_ERROR, "Could not read binary graph %s.", fname);
+        munmap(data, size);
+        return NULL;
+    }
+    if(header[2] != CAP_CODE){
+        snprintf(error, LOAD_ERROR, "Binary graph %s was written with another capacity type (code %d, this build uses %d).", fname, header[2], CAP_CODE);
+        munmap(data, size);
+        return NULL;
+    }
+
+    RESIDUAL check;                                     //Arrays are checked before anything is allocated
+    CAP *need = (CAP *)(header + BINARY_HEADER);        //Header is 24 bytes, so capacity arrays come first & stay aligned
+    check.V = V;
+    check.A = A;
+    check.cap   = need + V + 1;
+    check.first = (int *)(check.cap + A);
+    check.head  = check.first + V + 2;
+    check.rev   = check.head + A;
+    if(!CheckBinaryArrays(&check)){
+        snprintf(error, LOAD_ERROR, "Binary graph %s is corrupt.", fname);
+        munmap(data, size);
+        return NULL;
+    }
+
+    ARENA *arena = NewArena(), *residualArena = NewArena();
+    GRAPH *myGraph = (GRAPH *)ArenaAlloc(arena, sizeof(GRAPH));
+    RESIDUAL *R = (RESIDUAL *)ArenaAlloc(residualArena, sizeof(RESIDUAL));
+    myGraph->rank = NULL;
+    R->V = V;
+    R->A = A;
+    R->cap   = check.cap;
+    R->first = check.first;
+    R->head  = check.head;
+    R->rev   = check.rev;
+    R->flow  = (CAP *)ArenaCalloc(residualArena, A + 1, sizeof(CAP));
+    R->cost  = NULL;
+    R->bk    = NULL;
+    R->deadline = 0;
+    R->steps = -1;
+    R->stopped = 0;
+    R->edge  = (EDGE **)ArenaAlloc(residualArena, (A + 1)*sizeof(EDGE *));
+    R->map   = data;
+    R->mapSize = size;
+    R->arena = residualArena;
+
+    VERTEX *H = (VERTEX *)ArenaAlloc(arena, (V+1)*sizeof(VERTEX));
+    EDGE *block = (EDGE *)ArenaAlloc(arena, (E+1)*sizeof(EDGE));
+    int m = 0;
+    for(int i=1;i<=V;i++){
+        H[i].x = i;
+        H[i].n = need[i];
+        H[i].p = NULL;
+        for(int a=R->first[i]; a<R->first[i+1]; a++){
+            R->edge[a] = NULL;
+            if(!CAP_POSITIVE(R->cap[a]) || m == E) continue;   //Reverse arc
+
+            block[m].y = R->head[a];
+            block[m].c = R->cap[a];
+            block[m].f = 0;
+            block[m].w = 0;
+            block[m].next = NULL;
+            if(H[i].p == NULL) H[i].p = &block[m];
+            else               block[m-1].next = &block[m];
+            R->edge[a] = &block[m];
+            m++;
+        }
+    }
+
+    myGraph->V = V;
+    myGraph->E = m;
+    myGraph->W = 0;
+    myGraph->U = 1;
+    for(int k=0;k<m && myGraph->U;k++) myGraph->U = CAP_UNIT(block[k].c);
+    myGraph->H = H;
+    myGraph->R = R;
+    myGraph->arena = arena;
+    if(!CheckCapTotals(myGraph, fname, error)){
+        DestroyGraph(myGraph);                          //Also releases the mapping
+        return NULL;
+    }
+    return myGraph;
+}
+
+int CheckBinaryArrays(RESIDUAL *R){
+
+    /*
+     * Arguments      : Pointer to Residual Network pointing into a memory mapped binary graph
+     * Task Performed : Checks in one pass that first[] starts at 0 for vertices 0 & 1, never decreases & ends at A, that
+     *                  every head[a] is a vertex 1 .. V, that rev[a] is an arc leaving head[a] whose rev is a, & that no
+     *                  capacity is negative, so that engines may use the arrays as indexes without checking them
+     * Returns        : 1 if the arrays are consistent, 0 if not
+    */
+
+    if(R->first[0] != 0 || R->first[1] != 0 || R->first[R->V+1] != R->A) return 0;
+    for(int v=1;v<=R->V;v++) if(R->first[v+1] < R->first[v]) return 0;
+
+    for(int v=1;v<=R->V;v++){
+        for(int a=R->first[v]; a<R->first[v+1]; a++){
+            int w = R->head[a], b = R->rev[a];
+            if(w < 1 || w > R->V || b < R->first[w] || b >= R->first[w+1] || R->rev[b] != a) return 0;
+            if(!(R->cap[a] >= 0)) return 0;                //Also refuses NaN
+        }
+    }
+    return 1;
+}
+
+void WriteBinaryGraph(GRAPH *G, char *fname){
+
+    /*
+     * Arguments      : Pointer to Graph, character pointer to File Name
+     * Task Performed : Writes the graph in binary format : header (BINARY_MAGIC, BINARY_VERSION, CAP_CODE, V, E, A),
+     *                  need[0 .. V] & cap[A] as native CAP, then first[0 .. V+1], head[A] & rev[A] of the residual network
+     *                  as native ints
+     *                  NOTE : Flow & edge costs are not stored & edges with zero capacity are dropped
+     * Returns        : void
+    */
+
+    FILE *fptr = fopen(fname, "wb");
+    if (fptr == NULL){
+        printf("Could not open file %s.\n",fname);
+        exit(0);
+    }
+
+    RESIDUAL *R = G->R ? G->R : BuildResidual(G);
+
+    int header[BINARY_HEADER] = {BINARY_MAGIC, BINARY_VERSION, CAP_CODE, G->V, R->A/2, R->A};
+    fwrite(header, sizeof(int), BINARY_HEADER, fptr);
+    for(int i=0;i<=G->V;i++){
+        CAP n = i ? G->H[i].n : 0;
+        fwrite(&n, sizeof(CAP), 1, fptr);
+    }
+    fwrite(R->cap, sizeof(CAP), R->A, fptr);
+    fwrite(R->first, sizeof(int), G->V + 2, fptr);
+    fwrite(R->head, sizeof(int), R->A, fptr);
+    fwrite(R->rev, sizeof(int), R->A, fptr);
+    fclose(fptr);
+
+    if(R != G->R) FreeResidual(R);
+}
+
+void WriteTextGraph(GRAPH *G, char *fname){
+
+    /*
+     * Arguments      : Pointer to Graph, character pointer to File Name
+     * Task Performed : Writes the graph in the text format read by ReadGraph (V E, needs, then one "x y c" line per edge,
+     *                  "x y c w" when the graph has costs)
+     * Returns        : void
+    */
+
+    FILE *fptr = fopen(fname, "w");
+    if (fptr == NULL){
+        printf("Could not open file %s.\n",fname);
+        exit(0);
+    }
+
+    fprintf(fptr, "%d %d\n", G->V, G->E);
+    for(int i=1;i<=G->V;i++) fprintf(fptr, i < G->V ? CAP_FMT " " : CAP_FMT "\n", G->H[i].n);
+    for(int i=1;i<=G->V;i++){
+        for(EDGE *p = G->H[i].p; p!=NULL; p=p->next){
+            if(G->W) fprintf(fptr, "%d %d " CAP_FMT " %d\n", i, p->y, p->c, p->w);
+            else     fprintf(fptr, "%d %d " CAP_FMT "\n", i, p->y, p->c);
+        }
+    }
+    fclose(fptr);
+}
+
+/*------------------------------------------------------------------------------------------------------------------------------------------------*/
+/*----- Print Graph Function -----*/
+
+void PrintGraph(GRAPH G){
+    
+    /*
+     * Arguments      : Graph G
+     * Task Performed : Prints adjacenty list of Graph G in the following format
+     *                  V1 -> (V2,c2,f2) -> (V3,c3,f3)
+     *                  V2 
+     *                  V3
+     *                  The above network has 2 edges : One from V1 to V2 with capacity c2 & flow f2 
+     *                  and another one from V1 to V3 with capacity c3 & flow f3                      
+     * Returns        : void                 
+    */
+
+	printf("\nThe Graph is:- \n\n");
+	
+    VERTEX * H = G.H;
+	for(int x=1;x<=G.V;x++){               //Vertices & edges in the numbering of the input file
+		
+		printf("%d", x);
+		EDGE * pointer =H[InternalId(&G,x)].p;
+        
+		while(pointer!=NULL){
+
+			if(CAP_POSITIVE(pointer->c)) printf(" -> (%d," CAP_FMT "," CAP_FMT ") ",H[pointer->y].x,pointer->c,pointer->f);	//Print edges with positive capacities
+			pointer=pointer->next;
+		}
+
+		printf("\n");
+	}
+	printf("\n");
+}
+
+int InternalId(GRAPH *G, int x){
+
+    /*
+     * Arguments      : Pointer to Graph, id x of a vertex in the input file
+     * Task Performed : Looks x up in G->rank when the graph was reordered (H[v].x maps back)
+     * Returns        : Vertex of the graph numbered x in the file (x itself if it is not a vertex id)
+    */
+
+    if(G->rank == NULL || x < 1 || x > G->V) return x;
+    return G->rank[x];
+}
+
+/*------------------------------------------------------------------------------------------------------------------------------------------------*/
+/*----- Compute Max Flow Function -----*/
+
+void ComputeMaxFlow(GRAPH *G, int s, int t){
+    
+    /* 
+     * Based on       : Ford-Fulkerson Method
+     * Arguments      : Pointer to Graph, source vertex : s, sink vertex : t
+     * Task Performed : 1) Solves the network with SolveMaxFlow, or with BoundedMaxFlow when -budget or -steps is given
+     *                  2) Prints maximum flow for given network, source & sink vertex, or the bounds on it when the
+     *                     budget ran out first
+     * Returns        : void                 
+    */
+
+   CAP maxFlow;
+   if(Budget > 0 || StepBudget > 0){
+       CAP upper;
+       maxFlow = BoundedMaxFlow(G,s,t,&upper);
+       if(upper > maxFlow){
+           printf("\nThe budget ran out : a flow of " CAP_FMT " from Source (id -> %d) to Sink (id -> %d) was found & the maximum flow is at most " CAP_FMT " (gap %.2f%%).\n",
+                  maxFlow, G->H[s].x, G->H[t].x, upper, 100.0*(upper - maxFlow)/upper);
+           return;
+       }
+   }
+   else maxFlow = SolveMaxFlow(G,s,t);
+  
+   printf("\nThe maximum amount of integal flow that can flow from Source (id -> %d) to Sink (id -> %d) is " CAP_FMT ".\n", G->H[s].x,G->H[t].x,maxFlow);
+
+   /*   
+        // To check existence of Need Based Flow and print message accordingly
+
+        //Net need should be zero, sigma n[i]=0 is a neccesary condition for flow to exist.
+	    int net_need=0,flag=0;
+	    for(int i=1;i<=G->V;i++) net_need += G->H[i].n;
 	    if(net_need!=0) {
 	    		flag=1;
 	    		break; // Not feasible
@@ -347,6 +1506,202 @@ void ComputeMaxFlow(GRAPH *G, int s, int t){
 
 }
 
+CAP SolveMaxFlow(GRAPH *G, int s, int t){
+
+    /*
+     * Arguments      : Pointer to Graph, source vertex : s, sink vertex : t
+     * Task Performed : 1) Builds CSR residual network where every edge is paired with a reverse arc of capacity 0,
+     *                     the network is kept in G->R & reused by later calls (it is already built for binary graph files)
+     *                  2) Runs the selected solver engine (global var Engine) on the residual network using RunEngine
+     *                  3) Copies flow of every forward arc back to EDGE::f
+     *                  Solves that start from zero flow may take a shorter way :
+     *                  a) Unit capacity graph (G->U) that is a bipartite matching network between s & t, when no engine
+     *                     was chosen with -e (global var EngineChosen) : HopcroftKarp
+     *                  b) With -reduce (global var Reduce) : the engine runs on the network built by ReduceGraph & its
+     *                     flow is expanded onto the edges
+     *                  & the flow of the edges is copied into G->R if that exists. Unit capacity graphs that are not
+     *                  bipartite are solved by Dinic instead of the default Edmonds-Karp (O(E sqrt(E)) on unit capacities)
+     * Returns        : Value of the flow from s to t (engines may start from an existing flow, so this is the total)
+    */
+
+    int engine = G->U && !EngineChosen ? ENGINE_DINIC : Engine;
+    int fresh = 1;
+    if(G->R != NULL){
+        for(int a=0;a<G->R->A && fresh;a++) fresh = CAP_EQUAL(G->R->flow[a],0);
+    }
+
+    if(fresh && G->U && !EngineChosen){
+        char *side = (char *)malloc(G->V + 1);
+        if(DetectBipartite(G,s,t,side)){
+            STAT(double start = WallTime();)
+            CAP value = HopcroftKarp(G,s,side);
+            if(G->R != NULL) ReadBackFlow(G->R);
+            STAT(STAT_TIME(solveTime, start); STAT_ADD(solves, 1);)
+            free(side);
+            return value;
+        }
+        free(side);
+    }
+
+    if(fresh && Reduce){
+        STAT(double start = WallTime();)
+        REDUCTION *X = ReduceGraph(G,s,t);
+        STAT(STAT_TIME(reduceTime, start); start = WallTime();)
+
+        RunEngine(X->R,X->vertex[s],X->vertex[t],engine);
+        STAT(STAT_TIME(solveTime, start); start = WallTime();)
+
+        CAP value = FlowValue(X->R,X->vertex[s]);
+        ExpandFlow(X,G);
+        FreeReduction(X);
+        if(G->R != NULL) ReadBackFlow(G->R);
+        STAT(STAT_TIME(reduceTime, start); STAT_ADD(solves, 1);)
+        return value;
+    }
+
+    //Build residual network, every edge gets a paired reverse arc with capacity 0
+    STAT(double start = WallTime();)
+    if(G->R == NULL) G->R = BuildResidual(G);
+    RESIDUAL * R = G->R;
+    STAT(STAT_TIME(residualTime, start); start = WallTime();)
+
+    RunEngine(R,s,t,engine);
+    STAT(STAT_TIME(solveTime, start); start = WallTime();)
+
+    WriteBackFlow(R);
+    STAT(STAT_TIME(writeBackTime, start); STAT_ADD(solves, 1);)
+    return FlowValue(R,s);
+}
+
+CAP BoundedMaxFlow(GRAPH *G, int s, int t, CAP *upper){
+
+    /*
+     * Arguments      : Pointer to Graph, source vertex : s, sink vertex : t, pointer to upper bound to be set
+     * Task Performed : Like SolveMaxFlow, but the engine gets the budget of -budget & -steps (SetBudget) & stops
+     *                  augmenting when it runs out, leaving a valid flow. The cheapest cut among the BFS layers of the
+     *                  residual network (CutBound) bounds the maximum flow from above, it equals the flow when the engine
+     *                  finished. Hopcroft-Karp & -reduce are not used, they cannot stop half way
+     * Returns        : Value of the flow found (a lower bound on the maximum flow)
+    */
+
+    int engine = G->U && !EngineChosen ? ENGINE_DINIC : Engine;
+
+    STAT(double start = WallTime();)
+    if(G->R == NULL) G->R = BuildResidual(G);
+    RESIDUAL *R = G->R;
+    STAT(STAT_TIME(residualTime, start); start = WallTime();)
+
+    SetBudget(R);
+    RunEngine(R,s,t,engine);
+    R->deadline = 0;                                  //Later solves on this network are not limited
+    R->steps = -1;
+    STAT(STAT_TIME(solveTime, start); start = WallTime();)
+
+    WriteBackFlow(R);
+    STAT(STAT_TIME(writeBackTime, start); STAT_ADD(solves, 1);)
+
+    CAP lower = FlowValue(R,s);
+    *upper = R->stopped ? CutBound(R,s,t) : lower;
+    if(*upper < lower) *upper = lower;                //Rounding of floating point capacities
+    return lower;
+}
+
+void SetBudget(RESIDUAL *R){
+
+    /*
+     * Arguments      : Pointer to Residual Network
+     * Task Performed : Sets the deadline of the next engine run to now + Budget & its steps to StepBudget (global vars,
+     *                  0 means no limit) & clears stopped
+     * Returns        : void
+    */
+
+    R->deadline = Budget > 0 ? WallTime() + Budget : 0;
+    R->steps = StepBudget > 0 ? StepBudget : -1;
+    R->stopped = 0;
+}
+
+int BudgetSpent(RESIDUAL *R, int steps){
+
+    /*
+     * Arguments      : Pointer to Residual Network, number of steps the engine is about to take (0 : only check)
+     * Task Performed : Checks the deadline & the steps left of R, sets R->stopped when either ran out, otherwise takes
+     *                  the steps from those left. Engines call it where the arcs hold a flow they can stop at
+     * Returns        : 1 if the engine has to stop, 0 if not
+    */
+
+    if(R->steps < 0 && R->deadline == 0) return 0;
+    if(R->steps == 0 || (R->deadline > 0 && WallTime() >= R->deadline)){
+        R->stopped = 1;
+        return 1;
+    }
+    if(R->steps > 0) R->steps = R->steps > steps ? R->steps - steps : 0;
+    return 0;
+}
+
+CAP CutBound(RESIDUAL *R, int s, int t){
+
+    /*
+     * Arguments      : Pointer to Residual Network holding a flow, source vertex : s, sink vertex : t
+     * Task Performed : 1) BFS from s over arcs with residual capacity. For every level k before the level of t, the
+     *                     vertices of level <= k form an s-t cut, whose capacity is the sum of cap[a] over arcs leaving it.
+     *                     An arc from level i to level j (or to an unreached vertex) leaves the cuts i .. j-1, so all cut
+     *                     capacities come from one pass over the arcs & a prefix sum
+     *                  2) Same from t, over arcs with residual capacity into the vertex (cuts are the levels around t)
+     *                  When t cannot be reached from s, the vertices reached form a minimum cut, equal to the flow
+     * Returns        : Capacity of the cheapest cut found (an upper bound on the maximum flow)
+    */
+
+    int n = R->V;
+    int *level = (int *)malloc((n + 1)*sizeof(int));
+    int *queue = (int *)malloc((n + 1)*sizeof(int));
+    CAPWIDE *cut = (CAPWIDE *)malloc((n + 2)*sizeof(CAPWIDE));  //cut[k] stores the difference of cut k & cut k-1 until the sum
+    CAPWIDE best = CAP_MAX;                             //Flows fit in CAP, so CAP_MAX is an upper bound already
+
+    for(int side=0;side<2;side++){
+
+        int root = side ? t : s, other = side ? s : t;
+        for(int v=0;v<=n;v++) level[v] = -1;
+        int front = 0, rear = 0;
+        level[root] = 0;
+        queue[rear++] = root;
+        while(front < rear && level[other] == -1){
+            int v = queue[front++];
+            for(int a=R->first[v]; a<R->first[v+1]; a++){
+                int w = R->head[a];
+                int b = side ? R->rev[a] : a;             //Arc that needs residual capacity : v -> w from s, w -> v from t
+                if(level[w] != -1 || !CAP_POSITIVE(R->cap[b] - R->flow[b])) continue;
+                level[w] = level[v] + 1;
+                queue[rear++] = w;
+            }
+        }
+        int D = level[other] != -1 ? level[other] : level[queue[rear-1]] + 1;   //Cuts 0 .. D-1 separate s & t
+
+        for(int k=0;k<=D;k++) cut[k] = 0;
+        for(int v=1;v<=n;v++){
+            for(int a=R->first[v]; a<R->first[v+1]; a++){
+                if(!CAP_POSITIVE(R->cap[a])) continue;
+                int in = side ? R->head[a] : v;           //Vertex of the arc inside the cut
+                int out = side ? v : R->head[a];
+                if(level[in] == -1 || level[in] >= D) continue;
+                int hi = level[out] == -1 || level[out] > D ? D : level[out];
+                if(level[in] >= hi) continue;
+                cut[level[in]] += R->cap[a];
+                cut[hi] -= R->cap[a];
+            }
+        }
+        CAPWIDE sum = 0;
+        for(int k=0;k<D;k++){
+            sum += cut[k];
+            if(sum < best) best = sum;
+        }
+    }
+
+    free(level);
+    free(queue);
+    free(cut);
+    return (CAP)best;
+}
+
 /*------------------------------------------------------------------------------------------------------------------------------------------------*/
 /*----- Need Based Flow Function -----*/
 
@@ -354,27 +1709,67 @@ void NeedBasedFlow(GRAPH *G){
     /*
      * Based on       : Edmond-Karp Algorithm
      * Arguments      : Pointer to Grarph
-     * Task Performed : 1) Create Universal Source S
-     *                  2) Create Universal Sink T
-     *                  3) Connect all consumers to S with edge weight = need[i]
-     *                  4) Connect all producers to T with edge weight = -need[i]
+     * Task Performed : 1) Adds Universal Source S, Universal Sink T & their edges using function AddNeedEdges
      *                  Now, we apply computeMaxFlow() to find maxFlow in the above augmented graph.
      *                  The obtained maxFlow will be the need based flow for the original graph.
+     *                  2) When edges carry costs & the flow is feasible, MinCostCirculation turns it into the cheapest
+     *                     need based flow & its total cost is printed
      * Returns        : void                 
      * NOTE           : The algorithm assigns zero flow to all edges in network when no need based flow exists
     */
 
+    STAT(double start = WallTime();)
+    int added = AddNeedEdges(G);
+    STAT(STAT_TIME(needTime, start);)
+
+    double budget = Budget;
+    long stepBudget = StepBudget;
+    Budget = 0;                                     //Feasibility needs the maximum flow, the budget is only for s-t solves
+    StepBudget = 0;
+    if(added) ComputeMaxFlow(G,G->V-1,G->V);
+    Budget = budget;
+    StepBudget = stepBudget;
+
+    if(added && G->W && checkFeasibility(G)){
+        if(G->R == NULL) G->R = BuildResidual(G);       //Not built when the max flow was solved on the reduced graph
+        COSTSUM cost = MinCostCirculation(G->R);
+        WriteBackFlow(G->R);
+        printf("\nThe minimum cost of the need based flow is " COST_FMT ".\n", cost);
+    }
+
+    return;
+    
+}
+
+int AddNeedEdges(GRAPH *G){
+    /*
+     * Arguments      : Pointer to Grarph
+     * Task Performed : 1) Create Universal Source S (vertex V+1)
+     *                  2) Create Universal Sink T (vertex V+2)
+     *                  3) Connect all consumers to S with edge weight = need[i]
+     *                  4) Connect all producers to T with edge weight = -need[i]
+     * Returns        : 1 if S & T were added, 0 if net need is not zero (graph is left unchanged)
+    */
+
     //Condition 1
-    int net_need=0;
+    CAP net_need=0;
     for(int i=1;i<=G->V;i++){
         net_need  = net_need + G->H[i].n;
     }
 
-    if(net_need !=0) return;
+    if(!CAP_EQUAL(net_need,0)) return 0;
+
+    //Edges are about to change, so the residual network has to be built again
+    if(G->R != NULL){
+        FreeResidual(G->R);
+        G->R = NULL;
+    }
 
     //Add two more vertices (Universal source & sink) to current graph    
     G->V = G->V + 2;
-    G->H = (VERTEX*) realloc(G->H, (G->V +1)*sizeof(VERTEX) );
+    VERTEX *H = (VERTEX*) ArenaAlloc(G->arena, (G->V +1)*sizeof(VERTEX) );    //Old array stays in the arena
+    memcpy(H, G->H, (G->V - 1)*sizeof(VERTEX));
+    G->H = H;
     
     //Filling data for new 2 vertices
     int source = G->V - 1;
@@ -392,17 +1787,20 @@ void NeedBasedFlow(GRAPH *G){
     //Add new edges
     for(int i=1;i<=G->V;i++){
 
-        if(G->H[i].n == 0) continue;
+        if(CAP_EQUAL(G->H[i].n,0)) continue;
         if(G->H[i].n < 0)
         {
             //Vertex is a producer, so add an edge from source to vertex i
             EDGE *temp,*p;
-            temp = (EDGE*)malloc(sizeof(EDGE));
+            temp = (EDGE*)ArenaAlloc(G->arena, sizeof(EDGE));
             temp->y=i;
             temp->c = -G->H[i].n;
+            if(!CAP_UNIT(temp->c)) G->U = 0;
             temp->f = 0;
+            temp->w = 0;
             temp->next=NULL;
 
+            STAT_ADD(needEdges, 1);
             if(G->H[source].p==NULL) G->H[source].p=temp;
             else
             {
@@ -417,12 +1815,15 @@ void NeedBasedFlow(GRAPH *G){
         {
             //Vertex i is a consumer, so add an edge from vertex i to sink
             EDGE *temp,*p;
-            temp = (EDGE*)malloc(sizeof(EDGE));
+            temp = (EDGE*)ArenaAlloc(G->arena, sizeof(EDGE));
             temp->y=sink;
             temp->c = G->H[i].n;
+            if(!CAP_UNIT(temp->c)) G->U = 0;
             temp->f = 0;
+            temp->w = 0;
             temp->next=NULL;
 
+            STAT_ADD(needEdges, 1);
             if(G->H[i].p==NULL) G->H[i].p=temp;
             else{
                 p=G->H[i].p;
@@ -433,150 +1834,4261 @@ void NeedBasedFlow(GRAPH *G){
             } 
         }
     }
-     
-	ComputeMaxFlow(G,source,sink);
 
-    return;
-    
+    return 1;
+}
+
+CAP RunEngine(RESIDUAL *R, int s, int t, int engine){
+
+    /*
+     * Arguments      : Pointer to Residual Network, source vertex : s, sink vertex : t, engine id (ENGINE_*)
+     * Task Performed : Runs the engine on the residual network, search trees kept from a Boykov-Kolmogorov solve are
+     *                  dropped when another engine runs
+     * Returns        : Value returned by the engine
+    */
+
+    if(engine == ENGINE_DINIC)        return Dinic(R,s,t);
+    if(engine == ENGINE_PUSH_RELABEL) return PushRelabel(R,s,t);
+    if(engine == ENGINE_PARALLEL_PR)  return ParallelPushRelabel(R,s,t);
+    if(engine == ENGINE_BOYKOV_KOLMOGOROV) return BoykovKolmogorov(R,s,t);
+    FreeSearchTrees(R);                                   //Other engines change the flow under the trees
+    if(engine == ENGINE_SCALING)      return CapacityScaling(R,s,t);
+    return EdmondsKarp(R,s,t);
+}
+
+char *EngineName(int engine){
+
+    if(engine == ENGINE_DINIC)        return "dinic";
+    if(engine == ENGINE_PUSH_RELABEL) return "pr";
+    if(engine == ENGINE_PARALLEL_PR)  return "ppr";
+    if(engine == ENGINE_SCALING)      return "scaling";
+    if(engine == ENGINE_BOYKOV_KOLMOGOROV) return "bk";
+    return "ek";
+}
+
+int ParseEngine(char *name){
+
+    /*
+     * Arguments      : Character pointer to engine name (ek | dinic | pr | ppr | scaling | bk)
+     * Task Performed : Maps engine name to engine id, exits on unknown engine name
+     * Returns        : Engine id
+    */
+
+    if(strcmp(name,"ek")==0 || strcmp(name,"edmonds-karp")==0) return ENGINE_EDMONDS_KARP;
+    if(strcmp(name,"dinic")==0)                                return ENGINE_DINIC;
+    if(strcmp(name,"pr")==0 || strcmp(name,"push-relabel")==0) return ENGINE_PUSH_RELABEL;
+    if(strcmp(name,"ppr")==0)                                  return ENGINE_PARALLEL_PR;
+    if(strcmp(name,"scaling")==0)                              return ENGINE_SCALING;
+    if(strcmp(name,"bk")==0 || strcmp(name,"boykov-kolmogorov")==0) return ENGINE_BOYKOV_KOLMOGOROV;
+
+    printf("Unknown engine %s (expected ek | dinic | pr | ppr | scaling | bk).\n",name);
+    exit(0);
 }
 
-int BFS(int s,int t, GRAPH *G, int * parent){
+CAP BFS(int s,int t, RESIDUAL *R, WORKSPACE *W){
     
     /*
-     * Arguments      : Pointer to Grarph, source vertex : s, sink vertex : t, parent array to store augmenting path
-     * Task Performed : 1) Maintains two Queues namely, vertexQueue (used for performing BFS using queue) and 
-     *                     flowQueue (used to store flow of corresponding vertex in vertexQueue)      
-     *                  2) Any enque/dequeue operation on vertexQueue is accompanied by the same operation on flowQueue
-     *                  3) Performs BFS on graph G to find the shortest augmenting path
-     *                  4) Determines minimum capacity (stored in var newFlow) in the augmenting math
-     *                  5) Determines maximum of all the newFlows (stored in var maxFlow_path)on reaching the sink vertex
+     * Arguments      : Pointer to Residual Network, source vertex : s, sink vertex : t, workspace whose parent array stores
+     *                  the augmenting path
+     * Task Performed : 1) Performs BFS from s level by level, the queue of the workspace holds the levels one after the other,
+     *                     bottleneck[v] stores the minimum residual capacity on the path to v (the flow that can reach v).
+     *                     Arcs with residual capacity below W->delta are ignored
+     *                  2) BFSDirection picks the direction of every level :
+     *                     top-down  : scans the arcs leaving every vertex of the level
+     *                     bottom-up : puts the level in the frontier bitmap & scans every unvisited vertex v for an arc
+     *                                 entering it from the level (reverse arc rev[a] of an arc a leaving v), stopping at
+     *                                 the first one found. Large middle levels of low diameter graphs are cheaper this way
+     *                  3) Every arc into t is checked, the one giving the largest flow is stored as parent of t
+     *                  4) Once t has been reached, the level being scanned is finished (so every shortest augmenting path
+     *                     is looked at) & the BFS stops without exploring the rest of the graph
      * Returns        : maximum flow among all shortest augmenting paths (Returns 0 if no augmenting path found)                
      * 
-     * NOTE           : The algorithm assigns zero flow to all edges in network when no need based flow exists.
+     * NOTE           : parent[v] is only meaningful for vertices visited by this BFS (visited[v] == stamp).
+     *                  With more than one thread the search is done by ParallelBFS
     */
     
     if(s==t) return 0; //Trivial Corner Case Handling
+    if(W->P != NULL) return ParallelBFS(s,t,R,W);
 
-    for(int i=0;i<= G->V ;i++) {
-        parent[i]=-1;
+    if(W->stamp == INT_MAX){                        //Stamps wrapped, forget all earlier visits
+        for(int i=0;i<=W->V;i++) W->visited[i] = 0;
+        W->stamp = 0;
     }
-    parent[s]=0;
+    int stamp = ++W->stamp;
+    int *parent = W->parent, *queue = W->queue, *visited = W->visited, *first = R->first;
+    CAP *bottleneck = W->bottleneck;
+    unsigned long long *frontier = W->frontier;
 
-    int maxFlow_path=0;
-    Queue* vertexQueue = createQueue(MAX);
-    Queue* flowQueue   = createQueue(MAX);
-    enqueue(vertexQueue,s);                         //Starts with source vertex
-    enqueue(flowQueue,INT_MAX);                     //Denotes infinte flow edges
+    parent[s]=-2;                                   //Source has no entering arc, but is marked as visited
+    visited[s]=stamp;
+    bottleneck[s]=CAP_MAX;                          //Denotes infinte flow edges
 
-    while(!isEmpty(vertexQueue)){
+    CAP maxFlow_path=0;
+    int levelStart = 0, rear = 0, bottomUp = 0;
+    queue[rear++] = s;                              //Starts with source vertex
+    long frontierArcs = first[s+1] - first[s];
+    long unexploredArcs = R->A - frontierArcs;
+    STAT(long scanned = 0; long dequeued = 0;)
 
-        int currentVertex = dequeue(vertexQueue);
-        int currentFlow   = dequeue(flowQueue);    
-        
-        EDGE * pointer = G->H[currentVertex].p;
-
-        while(pointer!=NULL){
-            
-            int nextVertex = pointer->y;
-            int residualCapacity = pointer->c - pointer->f;
-            if(nextVertex==t){                                   //Update maxFlow_path if nextVertex is sink
-
-                int newFlow = currentFlow < residualCapacity ? currentFlow : residualCapacity;
-                       
-                if(maxFlow_path < newFlow){
-                    maxFlow_path= newFlow;
-                    parent[nextVertex]= currentVertex;
+    while(levelStart < rear && !CAP_POSITIVE(maxFlow_path)){     //Stop once the sink is reached from a whole level
+
+        int levelEnd = rear;
+        bottomUp = BFSDirection(bottomUp, R->V, levelEnd - levelStart, frontierArcs, unexploredArcs);
+        frontierArcs = 0;
+
+        if(!bottomUp){
+            for(int i=levelStart;i<levelEnd;i++){
+
+                int currentVertex = queue[i];
+                CAP currentFlow   = bottleneck[currentVertex];
+                STAT(scanned += first[currentVertex+1] - first[currentVertex]; dequeued++;)
+
+                for(int a=first[currentVertex]; a<first[currentVertex+1]; a++){   //Arcs of a vertex are contiguous
+                    
+                    int nextVertex = R->head[a];
+                    CAP residualCapacity = R->cap[a] - R->flow[a];
+                    if(!CAP_POSITIVE(residualCapacity) || residualCapacity < W->delta) continue;
+
+                    CAP newFlow = currentFlow < residualCapacity ? currentFlow : residualCapacity;
+                    if(nextVertex==t){                                   //Update maxFlow_path if nextVertex is sink
+                        if(maxFlow_path < newFlow){
+                            maxFlow_path= newFlow;
+                            parent[nextVertex]= a;
+                        }
+                    }
+                    else if(visited[nextVertex]!=stamp){
+                        
+                        visited[nextVertex] = stamp;
+                        parent[nextVertex] = a;                         //arc a leads from current vertex to next vertex
+                        bottleneck[nextVertex] = newFlow;
+                        queue[rear++] = nextVertex;                     //push next vertex in queue
+                        frontierArcs += first[nextVertex+1] - first[nextVertex];
+                    }
                 }
             }
-            else if(parent[nextVertex]==-1 && residualCapacity > 0){
-                
-                parent[nextVertex] = currentVertex;                                             //current vertex is parent of next vertex
-                int newFlow = currentFlow < residualCapacity ? currentFlow : residualCapacity;  //Update newFlow
-                enqueue(vertexQueue,nextVertex);                                                //push next vertex in queue
-                enqueue(flowQueue,newFlow);                                                     //push next flow in queue
+        }
+        else{
+            for(int i=levelStart;i<levelEnd;i++) frontier[queue[i] >> 6] |= 1ULL << (queue[i] & 63);
+            STAT(STAT_ADD(bottomUpSteps, 1);)
+
+            for(int v=1; v<=R->V; v++){
+
+                if(visited[v] == stamp) continue;                       //t is never marked, so it is always looked at
+                STAT(dequeued++;)
+
+                for(int a=first[v]; a<first[v+1]; a++){
+
+                    int u = R->head[a];
+                    STAT(scanned++;)
+                    if(!(frontier[u >> 6] >> (u & 63) & 1)) continue;
+
+                    int b = R->rev[a];                                  //arc b leads from u (in the level) to v
+                    CAP residualCapacity = R->cap[b] - R->flow[b];
+                    if(!CAP_POSITIVE(residualCapacity) || residualCapacity < W->delta) continue;
+
+                    CAP newFlow = bottleneck[u] < residualCapacity ? bottleneck[u] : residualCapacity;
+                    if(v == t){
+                        if(maxFlow_path < newFlow){
+                            maxFlow_path = newFlow;
+                            parent[t] = b;
+                        }
+                        continue;
+                    }
+                    visited[v] = stamp;
+                    parent[v] = b;
+                    bottleneck[v] = newFlow;
+                    queue[rear++] = v;
+                    frontierArcs += first[v+1] - first[v];
+                    break;                                              //One parent in the level is enough
+                }
             }
 
-            pointer=pointer->next;
+            for(int i=levelStart;i<levelEnd;i++) frontier[queue[i] >> 6] = 0;
         }
+
+        unexploredArcs -= frontierArcs;
+        levelStart = levelEnd;
     }
+    STAT(STAT_ADD(bfsCalls, 1); STAT_ADD(verticesDequeued, dequeued); STAT_ADD(arcsScanned, scanned);)
     return maxFlow_path;
 
 }
-int checkFeasibility(GRAPH *G){
+
+CAP ParallelBFS(int s, int t, RESIDUAL *R, WORKSPACE *W){
+
     /*
-     * Arguments      : Pointer to Grarph
-     * Task Performed : 1) Condition 1 : Sigma n[i]=0 is a neccesary condition for flow to exist.
-     *                  2) Condition 2 : Sum of assigned flow to Edges from universal source must be equal to sum of need of producers
-     *                  3) Condition 3 : Sum of assigned flow to Edges to universal sink must be equal to sum of need of consumers
-     *                  NOTE : Condition 2 and 3 are equivalent, checking any one of them is sufficient
-     * Returns        : 1 if need based flow is feasible, 0 if not              
+     * Arguments      : Pointer to Residual Network, source vertex : s, sink vertex : t, workspace with parallel BFS threads
+     * Task Performed : 1) Level synchronous BFS from s, the queue of the workspace holds the levels one after the other.
+     *                     Arcs with residual capacity below W->delta are ignored
+     *                  2) BFSDirection picks the direction of every level, the level is then split across the threads :
+     *                     top-down  : threads claim chunks of the level & lower mark[v] of every vertex v they reach to
+     *                                 the smallest arc from the level (compare & swap), the thread that moved v into the
+     *                                 level puts it in its next frontier buffer
+     *                     bottom-up : threads claim chunks of vertices & give every unvisited one the first arc of its
+     *                                 list entering it from the level
+     *                     Small top-down levels are expanded by the calling thread alone
+     *                  3) Stops after the level that reaches t, then follows the arcs stored in mark back from t to s,
+     *                     copying them to W->parent & taking the minimum residual capacity on the way
+     * Returns        : residual capacity of the shortest augmenting path found (Returns 0 if no augmenting path found)
+     *
+     * NOTE           : The path only depends on the graph & the flow, not on the thread count or thread timing, so
+     *                  solves are reproducible. Unlike the sequential BFS it is not the widest of the shortest paths
     */
 
-    //Net need should be zero, sigma n[i]=0 is a neccesary condition for flow to exist.
-    int net_need=0;
-    for(int i=1;i<=G->V;i++) net_need += G->H[i].n;
-    if(net_need!=0) return 0; // Not feasible
+    PARALLELBFS *P = W->P;
+    int *first = R->first;
 
-    //Assigned flow on every edge from source to a producer should be equal to its capacity
-    EDGE * p = G->H[G->V-1].p;
-    while(p!=NULL){
-       if(p->f != p->c) return 0; // Not feasible
+    if(P->level >= UINT_MAX - (unsigned)R->V - 2){     //Levels about to wrap, forget all earlier visits
+        for(int v=0;v<=R->V;v++) atomic_store_explicit(&P->mark[v], 0, memory_order_relaxed);
+        P->level = 0;
+    }
+    P->R = R;
+    P->t = t;
+    P->delta = W->delta;
+    P->queue = W->queue;
+    P->base = ++P->level;
+    atomic_store_explicit(&P->mark[s], (unsigned long long)P->base << 32 | 0xFFFFFFFFULL, memory_order_relaxed);
+
+    P->queue[0] = s;
+    P->levelStart = 0;
+    P->levelEnd = 1;
+    long frontierArcs = first[s+1] - first[s];
+    long unexploredArcs = R->A - frontierArcs;
+    int bottomUp = 0;
+
+    while(P->levelStart < P->levelEnd){
+
+        bottomUp = BFSDirection(bottomUp, R->V, P->levelEnd - P->levelStart, frontierArcs, unexploredArcs);
+        P->level++;
+        atomic_store(&P->rear, P->levelEnd);
+        atomic_store(&P->cursor, 0);
+        atomic_store(&P->nextArcs, 0);
+
+        if(bottomUp){
+            STAT(STAT_ADD(bottomUpSteps, 1);)
+            PBFSRunTask(P, PBFS_TASK_BOTTOM_UP);
+        }
+        else if(frontierArcs < PBFS_GRAIN) PBFSTopDownTask(P);     //Not worth waking the threads
+        else PBFSRunTask(P, PBFS_TASK_TOP_DOWN);
+
+        frontierArcs = atomic_load(&P->nextArcs);
+        unexploredArcs -= frontierArcs;
+        P->levelStart = P->levelEnd;
+        P->levelEnd = atomic_load(&P->rear);
+        if((unsigned)(atomic_load_explicit(&P->mark[t], memory_order_relaxed) >> 32) >= P->base) break;  //Sink reached
+    }
+    STAT(STAT_ADD(bfsCalls, 1);)
+
+    unsigned long long m = atomic_load_explicit(&P->mark[t], memory_order_relaxed);
+    if((unsigned)(m >> 32) < P->base) return 0;
+
+    CAP maxFlow_path = CAP_MAX;
+    for(int cur = t; cur != s; ){                      //Bottleneck is only needed along the path found
+        int a = (int)(atomic_load_explicit(&P->mark[cur], memory_order_relaxed) & 0xFFFFFFFFULL);
+        CAP residualCapacity = R->cap[a] - R->flow[a];
+        if(residualCapacity < maxFlow_path) maxFlow_path = residualCapacity;
+        W->parent[cur] = a;
+        cur = R->head[R->rev[a]];
+    }
+    W->parent[s] = -2;
+    return maxFlow_path;
+}
+
+void PBFSRunTask(PARALLELBFS *P, int task){
+
+    /*
+     * Arguments      : Pointer to parallel BFS state, task id
+     * Task Performed : Called by the main thread only. Releases the workers waiting on the barrier, runs the task itself
+     *                  & waits on the barrier until every thread has finished it
+     * Returns        : void
+    */
+
+    P->task = task;
+    pthread_barrier_wait(&P->barrier);
+    if(task == PBFS_TASK_EXIT) return;
+    if(task == PBFS_TASK_TOP_DOWN) PBFSTopDownTask(P);
+    else                           PBFSBottomUpTask(P);
+    pthread_barrier_wait(&P->barrier);
+}
+
+void *PBFSWorker(void *arg){
+
+    PARALLELBFS *P = (PARALLELBFS*)arg;
+
+    while(1){
+        pthread_barrier_wait(&P->barrier);                  //Wait for the next level
+        if(P->task == PBFS_TASK_EXIT) break;
+        if(P->task == PBFS_TASK_TOP_DOWN) PBFSTopDownTask(P);
+        else                              PBFSBottomUpTask(P);
+        pthread_barrier_wait(&P->barrier);                  //Level finished
+    }
+    return NULL;
+}
+
+void PBFSTopDownTask(PARALLELBFS *P){
+
+    /*
+     * Arguments      : Pointer to parallel BFS state
+     * Task Performed : Claims chunks of the level & scans the residual arcs a = u -> v of every claimed vertex u. If v was
+     *                  not reached by an earlier level, mark[v] is set to (level, a) unless it already holds this level with
+     *                  a smaller arc (compare & swap loop). The thread whose swap brought v into the level buffers v
+     * Returns        : void
+    */
+
+    RESIDUAL *R = P->R;
+    unsigned long long level = P->level;
+    int buffer[PBFS_BUFFER];
+    int count = 0;
+    long arcs = 0;
+    STAT(long scanned = 0; long dequeued = 0;)
+
+    while(1){
+
+        int start = P->levelStart + atomic_fetch_add_explicit(&P->cursor, PBFS_CHUNK, memory_order_relaxed);
+        if(start >= P->levelEnd) break;
+        int end = start + PBFS_CHUNK < P->levelEnd ? start + PBFS_CHUNK : P->levelEnd;
+
+        for(int i=start;i<end;i++){
+
+            int u = P->queue[i];
+            STAT(scanned += R->first[u+1] - R->first[u]; dequeued++;)
+
+            for(int a=R->first[u]; a<R->first[u+1]; a++){
+
+                CAP residualCapacity = R->cap[a] - R->flow[a];
+                if(!CAP_POSITIVE(residualCapacity) || residualCapacity < P->delta) continue;
+
+                int v = R->head[a];
+                unsigned long long want = level << 32 | (unsigned)a;
+                unsigned long long old = atomic_load_explicit(&P->mark[v], memory_order_relaxed);
+                while(1){
+                    unsigned reached = (unsigned)(old >> 32);
+                    if(reached >= P->base && reached != level) break;          //Reached by an earlier level
+                    if(reached == level && old <= want) break;                 //A smaller arc of this level won
+                    if(atomic_compare_exchange_weak_explicit(&P->mark[v], &old, want, memory_order_relaxed, memory_order_relaxed)){
+                        if(reached != level && v != P->t){
+                            buffer[count++] = v;
+                            arcs += R->first[v+1] - R->first[v];
+                            if(count == PBFS_BUFFER){
+                                PBFSFlush(P, buffer, count);
+                                count = 0;
+                            }
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    PBFSFlush(P, buffer, count);
+    atomic_fetch_add_explicit(&P->nextArcs, arcs, memory_order_relaxed);
+    STAT(STAT_ADD(verticesDequeued, dequeued); STAT_ADD(arcsScanned, scanned);)
+}
+
+void PBFSBottomUpTask(PARALLELBFS *P){
+
+    /*
+     * Arguments      : Pointer to parallel BFS state
+     * Task Performed : Claims chunks of vertices 1 .. V. Every claimed vertex v not reached yet scans its arcs for an arc
+     *                  entering it from the level (reverse arc rev[a] of an arc a leaving v, whose head has the previous
+     *                  level in mark) with enough residual capacity, takes the first one found as parent & is buffered.
+     *                  Only the thread that claimed v writes mark[v]
+     * Returns        : void
+    */
+
+    RESIDUAL *R = P->R;
+    unsigned long long level = P->level;
+    int buffer[PBFS_BUFFER];
+    int count = 0;
+    long arcs = 0;
+    STAT(long scanned = 0; long dequeued = 0;)
+
+    while(1){
+
+        int start = 1 + atomic_fetch_add_explicit(&P->cursor, PBFS_CHUNK, memory_order_relaxed);
+        if(start > R->V) break;
+        int end = start + PBFS_CHUNK <= R->V ? start + PBFS_CHUNK : R->V + 1;
+
+        for(int v=start;v<end;v++){
+
+            if((unsigned)(atomic_load_explicit(&P->mark[v], memory_order_relaxed) >> 32) >= P->base) continue;
+            STAT(dequeued++;)
+
+            for(int a=R->first[v]; a<R->first[v+1]; a++){
+
+                int u = R->head[a];
+                STAT(scanned++;)
+                if((unsigned)(atomic_load_explicit(&P->mark[u], memory_order_relaxed) >> 32) != level - 1) continue;
+
+                int b = R->rev[a];                                  //arc b leads from u (in the level) to v
+                CAP residualCapacity = R->cap[b] - R->flow[b];
+                if(!CAP_POSITIVE(residualCapacity) || residualCapacity < P->delta) continue;
+
+                atomic_store_explicit(&P->mark[v], level << 32 | (unsigned)b, memory_order_relaxed);
+                if(v != P->t){
+                    buffer[count++] = v;
+                    arcs += R->first[v+1] - R->first[v];
+                    if(count == PBFS_BUFFER){
+                        PBFSFlush(P, buffer, count);
+                        count = 0;
+                    }
+                }
+                break;                                              //One parent in the level is enough
+            }
+        }
+    }
+
+    PBFSFlush(P, buffer, count);
+    atomic_fetch_add_explicit(&P->nextArcs, arcs, memory_order_relaxed);
+    STAT(STAT_ADD(verticesDequeued, dequeued); STAT_ADD(arcsScanned, scanned);)
+}
+
+void PBFSFlush(PARALLELBFS *P, int *buffer, int count){
+
+    /*
+     * Arguments      : Pointer to parallel BFS state, next frontier buffer of a thread & number of vertices in it
+     * Task Performed : Reserves count entries at the rear of the queue with one atomic add & copies the buffer there
+     *                  (every vertex enters the queue at most once, so the queue never overflows)
+     * Returns        : void
+    */
+
+    if(count == 0) return;
+    int at = atomic_fetch_add_explicit(&P->rear, count, memory_order_relaxed);
+    memcpy(P->queue + at, buffer, count*sizeof(int));
+}
+
+int BFSDirection(int bottomUp, int V, int frontier, long frontierArcs, long unexploredArcs){
+
+    /*
+     * Arguments      : 1 if the last level was expanded bottom-up, number of vertices V, vertices & arcs of the level to expand,
+     *                  arcs of vertices not reached yet
+     * Task Performed : Direction optimizing heuristic : top-down while the level has few arcs compared to the unexplored part
+     *                  of the graph, bottom-up while the level stays large (at least V / BFS_BETA vertices)
+     * Returns        : 1 to expand the level bottom-up, 0 for top-down
+    */
+
+    if(!bottomUp) return frontierArcs > unexploredArcs / BFS_ALPHA;
+    return frontier >= V / BFS_BETA;
+}
+
+WORKSPACE *CreateWorkspace(int V){
+
+    WORKSPACE *W = (WORKSPACE *)malloc(sizeof(WORKSPACE));
+    W->V = V;
+    W->parent     = (int *)malloc((V + 1)*sizeof(int));
+    W->bottleneck = (CAP *)malloc((V + 1)*sizeof(CAP));
+    W->queue      = (int *)malloc((V + 1)*sizeof(int));
+    W->visited    = (int *)calloc(V + 1, sizeof(int));
+    W->stamp      = 0;
+    W->delta      = 0;
+    W->frontier   = (unsigned long long *)calloc(V/64 + 1, sizeof(unsigned long long));
+    W->P          = NULL;
+
+    if(Threads > 1){                                //Threads of the parallel BFS live as long as the workspace
+        PARALLELBFS *P = (PARALLELBFS *)malloc(sizeof(PARALLELBFS));
+        P->threads = Threads;
+        P->mark    = (atomic_ullong *)malloc((V + 1)*sizeof(atomic_ullong));
+        for(int v=0;v<=V;v++) atomic_init(&P->mark[v], 0);
+        P->level   = 0;
+        P->worker  = (pthread_t *)malloc(P->threads*sizeof(pthread_t));
+        pthread_barrier_init(&P->barrier, NULL, P->threads);
+        for(int i=1;i<P->threads;i++) pthread_create(&P->worker[i], NULL, PBFSWorker, P);
+        W->P = P;
+    }
+    return W;
+}
+
+void FreeWorkspace(WORKSPACE *W){
+
+    if(W->P != NULL){
+        PBFSRunTask(W->P, PBFS_TASK_EXIT);
+        for(int i=1;i<W->P->threads;i++) pthread_join(W->P->worker[i], NULL);
+        pthread_barrier_destroy(&W->P->barrier);
+        free(W->P->worker);
+        free(W->P->mark);
+        free(W->P);
+    }
+    free(W->parent);
+    free(W->bottleneck);
+    free(W->queue);
+    free(W->visited);
+    free(W->frontier);
+    free(W);
+}
+
+int checkFeasibility(GRAPH *G){
+    /*
+     * Arguments      : Pointer to Grarph
+     * Task Performed : 1) Condition 1 : Sigma n[i]=0 is a neccesary condition for flow to exist.
+     *                  2) Condition 2 : Sum of assigned flow to Edges from universal source must be equal to sum of need of producers
+     *                  3) Condition 3 : Sum of assigned flow to Edges to universal sink must be equal to sum of need of consumers
+     *                  NOTE : Condition 2 and 3 are equivalent, checking any one of them is sufficient
+     * Returns        : 1 if need based flow is feasible, 0 if not              
+    */
+
+    //Net need should be zero, sigma n[i]=0 is a neccesary condition for flow to exist.
+    CAP net_need=0;
+    for(int i=1;i<=G->V;i++) net_need += G->H[i].n;
+    if(!CAP_EQUAL(net_need,0)) return 0; // Not feasible
+
+    //Assigned flow on every edge from source to a producer should be equal to its capacity
+    EDGE * p = G->H[G->V-1].p;
+    while(p!=NULL){
+       if(!CAP_EQUAL(p->f,p->c)) return 0; // Not feasible
        p=p->next;
     }
     
     //Assigned flow on every edge from a consumer to a sink should be equal to its capacity
     EDGE * q = G->H[G->V-1].p;
     while(q!=NULL){
-       if(q->f != q->c) return 0; // Not feasible
+       if(!CAP_EQUAL(q->f,q->c)) return 0; // Not feasible
        q=q->next;
     }
 
     return 1;
 }
 //--------------------------------------------------------------------------------------------------------------------------------
-/* --- Queue Standard Functions (Implemented using array) --*/
-
-Queue* createQueue(int capacity) 
-{ 
-    Queue* queue =(Queue*)malloc(sizeof(Queue)); 
-    queue->capacity = capacity; 
-    queue->front = 0;
-    queue->size = 0; 
-    queue->rear = capacity - 1; 
-    queue->array = (int*)malloc(capacity*sizeof(int));
-    return queue; 
-} 
-
-int isFull(Queue* queue) 
-{ 
-    return (queue->size == queue->capacity); 
-} 
-
-int isEmpty(Queue* queue) 
-{ 
-    return (queue->size == 0); 
-} 
-  
-void enqueue(Queue* queue, int item) 
-{ 
-    if (isFull(queue)) return; 
-    queue->rear = (queue->rear + 1) % queue->capacity; 
-    queue->array[queue->rear] = item; 
-    queue->size = queue->size + 1; 
-} 
-  
-int dequeue(Queue* queue) 
-{ 
-    if (isEmpty(queue)) return -1; 
-    int item = queue->array[queue->front]; 
-    queue->front = (queue->front + 1) % queue->capacity; 
-    queue->size = queue->size - 1; 
-    return item; 
-} 
-  
-int front(Queue* queue) 
-{ 
-    if (isEmpty(queue)) return -1; 
-    return queue->array[queue->front]; 
-} 
+/* --- Min-Cost Flow Functions (cost scaling on the residual network) --*/
+
+COSTSUM MinCostCirculation(RESIDUAL *R){
+
+    /*
+     * Based on       : Goldberg's Cost Scaling Push-Relabel Algorithm
+     * Arguments      : Pointer to Residual Network holding a feasible flow (need based flow) & arc costs
+     * Task Performed : 1) Costs are multiplied by V + 1, so that an eps-optimal flow with eps < V + 1 is optimal for the
+     *                     original costs. Prices start at 0 & eps at the largest scaled cost
+     *                  2) Repeatedly divides eps by MCF_ALPHA & makes the flow eps-optimal (MCFRefine) until eps is 1
+     *                  Refines only move flow around cycles, so the excess of every vertex (& flow value) is unchanged
+     * Returns        : Total cost of the flow (sum of flow * cost over forward arcs)
+     * NOTE           : Without arc costs the flow is returned unchanged with cost 0
+    */
+
+    if(R->cost == NULL) return 0;
+    FreeSearchTrees(R);                         //Flow moves around cycles under the trees
+
+    int n = R->V;
+    long long scale = n + 1;
+    long long eps = 0;
+    for(int a=0;a<R->A;a++){
+        long long c = R->cost[a] < 0 ? -(long long)R->cost[a] : R->cost[a];
+        if(c*scale > eps) eps = c*scale;
+    }
+
+    long long *price = (long long *)calloc(n + 1, sizeof(long long));
+    CAP *excess = (CAP *)malloc((n + 1)*sizeof(CAP));
+    int *it = (int *)malloc((n + 1)*sizeof(int));
+    int *queue = (int *)malloc((n + 1)*sizeof(int));
+    char *queued = (char *)malloc(n + 1);
+
+    while(eps > 1){
+        eps = eps/MCF_ALPHA > 1 ? eps/MCF_ALPHA : 1;
+        MCFRefine(R, eps, scale, price, excess, it, queue, queued);
+    }
+
+    COSTSUM total = 0;
+    for(int a=0;a<R->A;a++){
+        if(R->edge[a] != NULL) total += (COSTSUM)R->flow[a]*R->cost[a];
+    }
+
+    free(price);
+    free(excess);
+    free(it);
+    free(queue);
+    free(queued);
+    return total;
+}
+
+void MCFRefine(RESIDUAL *R, long long eps, long long scale, long long *price, CAP *excess, int *it, int *queue, char *queued){
+
+    /*
+     * Arguments      : Pointer to Residual Network, eps, cost multiplier, prices, work arrays of size V+1 : excess,
+     *                  current arcs, circular queue & queue marks
+     * Task Performed : 1) Saturates every residual arc with negative reduced cost (cost * scale + price[u] - price[v]),
+     *                     which leaves excess at some vertices & deficits at others
+     *                  2) Discharges vertices with excess in FIFO order : pushes along admissible arcs (residual capacity > 0 &
+     *                     negative reduced cost), when none is left relabels v so that its cheapest residual arc has
+     *                     reduced cost -eps
+     *                  Afterwards every residual arc has reduced cost >= -eps (flow is eps-optimal)
+     * Returns        : void
+    */
+
+    int n = R->V;
+
+    for(int v=1;v<=n;v++){
+        excess[v] = 0;
+        it[v] = R->first[v];
+        queued[v] = 0;
+    }
+
+    for(int v=1;v<=n;v++){
+        for(int a=R->first[v]; a<R->first[v+1]; a++){
+            CAP d = R->cap[a] - R->flow[a];
+            int w = R->head[a];
+            if(!CAP_POSITIVE(d) || R->cost[a]*scale + price[v] - price[w] >= 0) continue;
+            PushArc(R,a,d);
+            excess[v] -= d;
+            excess[w] += d;
+        }
+    }
+
+    int front = 0, rear = 0, size = 0;
+    for(int v=1;v<=n;v++){
+        if(CAP_POSITIVE(excess[v])){
+            queue[rear] = v;
+            rear = (rear + 1) % (n + 1);
+            size++;
+            queued[v] = 1;
+        }
+    }
+
+    while(size > 0){
+
+        int v = queue[front];
+        front = (front + 1) % (n + 1);
+        size--;
+        queued[v] = 0;
+
+        while(CAP_POSITIVE(excess[v])){
+
+            int a;
+            for(a=it[v]; a<R->first[v+1]; a++){
+
+                int w = R->head[a];
+                CAP residualCapacity = R->cap[a] - R->flow[a];
+                if(!CAP_POSITIVE(residualCapacity) || R->cost[a]*scale + price[v] - price[w] >= 0) continue;
+
+                CAP d = excess[v] < residualCapacity ? excess[v] : residualCapacity;
+                PushArc(R,a,d);
+                excess[v] -= d;
+                excess[w] += d;
+                if(CAP_POSITIVE(excess[w]) && !queued[w]){
+                    queue[rear] = w;
+                    rear = (rear + 1) % (n + 1);
+                    size++;
+                    queued[w] = 1;
+                }
+
+                if(!CAP_POSITIVE(excess[v])) break;
+            }
+
+            if(a < R->first[v+1]){
+                it[v] = a;                                    //Arc may still be admissible
+                break;
+            }
+
+            //Relabel : lower price of v until its cheapest residual arc has reduced cost -eps
+            long long best = LLONG_MIN;
+            for(int b=R->first[v]; b<R->first[v+1]; b++){
+                if(!CAP_POSITIVE(R->cap[b] - R->flow[b])) continue;
+                long long candidate = price[R->head[b]] - R->cost[b]*scale;
+                if(candidate > best) best = candidate;
+            }
+            price[v] = best - eps;                            //Excess always has a residual arc (back along its inflow)
+            it[v] = R->first[v];
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+/* --- Gomory-Hu Tree Functions (all pairs minimum cuts of undirected networks) --*/
+
+CUTTREE *BuildCutTree(GRAPH *G){
+
+    /*
+     * Based on       : Gusfield's Algorithm
+     * Arguments      : Pointer to Graph, every edge (x, y, c) is taken as an undirected edge of capacity c
+     * Task Performed : 1) Builds a residual network where both arcs of an edge get capacity c
+     *                  2) Starts with parent[v] = 1 for all v. For s = 2 .. V, computes minimum cut between s & t = parent[s]
+     *                     with the selected engine, sets weight[s] to its value & moves every later vertex i with
+     *                     parent[i] = t that lies on the side of s under s
+     *                  3) Cuts of Threads consecutive vertices are computed in parallel with the parents known at the
+     *                     start of the batch, they are applied in order & recomputed if an earlier cut of the batch changed
+     *                     parent[s] (cut values do not depend on the tree, only on the pair)
+     *                  4) Computes depth & binary lifting tables for CutTreeQuery
+     * Returns        : Pointer to the tree
+    */
+
+    RESIDUAL *R = BuildResidual(G);
+    for(int a=0;a<R->A;a++){
+        R->flow[a] = 0;
+        if(R->edge[a] != NULL) R->cap[R->rev[a]] = R->cap[a];     //Undirected edge
+    }
+
+    int n = G->V;
+    CUTTREE *T = (CUTTREE *)malloc(sizeof(CUTTREE));
+    T->V = n;
+    T->parent = (int *)malloc((n + 1)*sizeof(int));
+    T->weight = (CAP *)malloc((n + 1)*sizeof(CAP));
+    T->depth  = (int *)malloc((n + 1)*sizeof(int));
+    for(int v=0;v<=n;v++){
+        T->parent[v] = 1;
+        T->weight[v] = CAP_MAX;
+    }
+
+    int threads = Threads > 0 ? Threads : 1;
+    Threads = 1;                                    //Cuts already run in parallel, the BFS of each one stays sequential
+    CUTJOB *job = (CUTJOB *)malloc(threads*sizeof(CUTJOB));
+    pthread_t *worker = (pthread_t *)malloc(threads*sizeof(pthread_t));
+    for(int j=0;j<threads;j++){
+        job[j].R = *R;
+        job[j].R.flow = (CAP *)malloc((R->A + 1)*sizeof(CAP));
+        job[j].R.bk = NULL;
+        job[j].side = (char *)malloc(n + 1);
+        job[j].queue = (int *)malloc((n + 1)*sizeof(int));
+    }
+
+    for(int first=2; first<=n; first+=threads){
+
+        int batch = n - first + 1 < threads ? n - first + 1 : threads;
+        for(int j=0;j<batch;j++){
+            job[j].s = first + j;
+            job[j].t = T->parent[first + j];
+        }
+        for(int j=1;j<batch;j++) pthread_create(&worker[j], NULL, CutJob, &job[j]);
+        CutJob(&job[0]);
+        for(int j=1;j<batch;j++) pthread_join(worker[j], NULL);
+
+        for(int j=0;j<batch;j++){
+            int s = first + j;
+            if(job[j].t != T->parent[s]){                 //Speculation failed, parent changed by an earlier cut
+                job[j].t = T->parent[s];
+                CutJob(&job[j]);
+            }
+            T->weight[s] = job[j].value;
+            for(int i=s+1;i<=n;i++){
+                if(T->parent[i] == job[j].t && job[j].side[i]) T->parent[i] = s;
+            }
+        }
+    }
+
+    for(int j=0;j<threads;j++){
+        free(job[j].R.flow);
+        free(job[j].side);
+        free(job[j].queue);
+    }
+    free(job);
+    free(worker);
+    FreeResidual(R);
+    Threads = threads;
+
+    //Parents always have smaller ids, so depths can be filled in increasing order
+    T->depth[0] = 0;
+    if(n >= 1) T->depth[1] = 0;
+    for(int v=2;v<=n;v++) T->depth[v] = T->depth[T->parent[v]] + 1;
+
+    T->LOG = 1;
+    while((1 << T->LOG) <= n) T->LOG++;
+    T->up  = (int **)malloc(T->LOG*sizeof(int *));
+    T->low = (CAP **)malloc(T->LOG*sizeof(CAP *));
+    for(int k=0;k<T->LOG;k++){
+        T->up[k]  = (int *)malloc((n + 1)*sizeof(int));
+        T->low[k] = (CAP *)malloc((n + 1)*sizeof(CAP));
+        for(int v=0;v<=n;v++){
+            if(k == 0){
+                T->up[0][v]  = v > 1 ? T->parent[v] : v;
+                T->low[0][v] = v > 1 ? T->weight[v] : CAP_MAX;
+            }
+            else{
+                int mid = T->up[k-1][v];
+                T->up[k][v]  = T->up[k-1][mid];
+                T->low[k][v] = T->low[k-1][v] < T->low[k-1][mid] ? T->low[k-1][v] : T->low[k-1][mid];
+            }
+        }
+    }
+
+    return T;
+}
+
+void *CutJob(void *arg){
+
+    /*
+     * Arguments      : Pointer to CUTJOB
+     * Task Performed : Computes maximum flow from s to t starting from zero flow with the selected engine
+     *                  (the parallel engine is replaced by the sequential push-relabel, jobs already run in parallel),
+     *                  then marks vertices reachable from s in the residual network as the side of s
+     * Returns        : NULL
+    */
+
+    CUTJOB *job = (CUTJOB *)arg;
+    RESIDUAL *R = &job->R;
+
+    for(int a=0;a<R->A;a++) R->flow[a] = 0;
+    job->value = RunEngine(R, job->s, job->t, Engine == ENGINE_PARALLEL_PR ? ENGINE_PUSH_RELABEL : Engine);
+    FreeSearchTrees(R);                     //The next cut of this job starts from zero flow
+
+    for(int v=0;v<=R->V;v++) job->side[v] = 0;
+    int front = 0, rear = 0;
+    job->side[job->s] = 1;
+    job->queue[rear++] = job->s;
+    while(front < rear){
+        int v = job->queue[front++];
+        for(int a=R->first[v]; a<R->first[v+1]; a++){
+            int w = R->head[a];
+            if(!job->side[w] && CAP_POSITIVE(R->cap[a] - R->flow[a])){
+                job->side[w] = 1;
+                job->queue[rear++] = w;
+            }
+        }
+    }
+    return NULL;
+}
+
+CAP CutTreeQuery(CUTTREE *T, int u, int v){
+
+    /*
+     * Arguments      : Pointer to Gomory-Hu tree, vertices u & v
+     * Task Performed : Lifts the deeper vertex to the depth of the other, then lifts both up to their lowest common ancestor,
+     *                  keeping the minimum weight of all tree edges passed
+     * Returns        : Maximum flow between u & v (CAP_MAX if u = v)
+    */
+
+    CAP result = CAP_MAX;
+    if(T->depth[u] < T->depth[v]){
+        int swap = u;
+        u = v;
+        v = swap;
+    }
+
+    int diff = T->depth[u] - T->depth[v];
+    for(int k=0;k<T->LOG;k++){
+        if(diff & (1 << k)){
+            if(T->low[k][u] < result) result = T->low[k][u];
+            u = T->up[k][u];
+        }
+    }
+    if(u == v) return result;
+
+    for(int k=T->LOG-1;k>=0;k--){
+        if(T->up[k][u] != T->up[k][v]){
+            if(T->low[k][u] < result) result = T->low[k][u];
+            if(T->low[k][v] < result) result = T->low[k][v];
+            u = T->up[k][u];
+            v = T->up[k][v];
+        }
+    }
+    if(T->low[0][u] < result) result = T->low[0][u];
+    if(T->low[0][v] < result) result = T->low[0][v];
+    return result;
+}
+
+void FreeCutTree(CUTTREE *T){
+
+    for(int k=0;k<T->LOG;k++){
+        free(T->up[k]);
+        free(T->low[k]);
+    }
+    free(T->up);
+    free(T->low);
+    free(T->parent);
+    free(T->weight);
+    free(T->depth);
+    free(T);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+/* --- Graph Reduction Functions (smaller network for one s-t solve, flow expanded back onto the edges) --*/
+
+REDUCTION *ReduceGraph(GRAPH *G, int s, int t){
+
+    /*
+     * Arguments      : Pointer to Graph, source vertex : s, sink vertex : t
+     * Task Performed : 1) Prune : keeps only vertices reachable from s & reaching t along edges of positive capacity (flow
+     *                     through any other vertex could only circulate), self loops are dropped
+     *                  2) Contract chains : a vertex x other than s & t with exactly one entering segment (p, x) & one
+     *                     leaving segment (x, q) is removed & both segments become one segment (p, q) whose capacity is the
+     *                     smaller one (a cycle p -> x -> p is dropped). Segments entering & leaving a vertex are counted
+     *                     with in / out & found through the xor of their ids, so every contraction takes O(1)
+     *                  3) Merge : segments joining the same two vertices are sorted together (two counting sort passes)
+     *                     & become one arc pair, the arc from the smaller to the larger vertex has the capacity of the
+     *                     parallel segments in its direction & its paired arc the capacity of the antiparallel ones
+     *                  4) Builds the CSR residual network of the arc pairs on the remaining vertices, renumbered in order
+     * Returns        : Pointer to reduction (network & mapping)
+     * NOTE           : Segments are nodes of the mapping, the network starts with zero flow
+    */
+
+    int V = G->V;
+    REDUCTION *X = (REDUCTION *)malloc(sizeof(REDUCTION));
+
+    //Reverse adjacency (edges entering v at redge[rfirst[v] .. rfirst[v+1]-1]) for the backward search from t
+    int E = 0;
+    int *rfirst = (int *)calloc(V + 2, sizeof(int));
+    for(int i=1;i<=V;i++){
+        for(EDGE *p = G->H[i].p; p!=NULL; p=p->next){
+            if(!CAP_POSITIVE(p->c) || p->y == i) continue;
+            rfirst[p->y+1]++;
+            E++;
+        }
+    }
+    for(int i=1;i<=V+1;i++) rfirst[i] += rfirst[i-1];
+    int *rtail = (int *)malloc((E + 1)*sizeof(int));
+    int *pos = (int *)malloc((V + 2)*sizeof(int));
+    for(int i=0;i<=V+1;i++) pos[i] = rfirst[i];
+    for(int i=1;i<=V;i++){
+        for(EDGE *p = G->H[i].p; p!=NULL; p=p->next){
+            if(CAP_POSITIVE(p->c) && p->y != i) rtail[pos[p->y]++] = i;
+        }
+    }
+    STAT_ADD(reduceVertices, V);
+    STAT_ADD(reduceEdges, E);
+
+    //1) Prune : keep[v] bit 1 if reached from s, bit 2 if t is reached from v
+    char *keep = (char *)calloc(V + 1, 1);
+    int *queue = (int *)malloc((V + 1)*sizeof(int));
+    int front = 0, rear = 0;
+    keep[s] |= 1;
+    queue[rear++] = s;
+    while(front < rear){
+        int v = queue[front++];
+        for(EDGE *p = G->H[v].p; p!=NULL; p=p->next){
+            if(CAP_POSITIVE(p->c) && !(keep[p->y] & 1)){
+                keep[p->y] |= 1;
+                queue[rear++] = p->y;
+            }
+        }
+    }
+    front = rear = 0;
+    keep[t] |= 2;
+    queue[rear++] = t;
+    while(front < rear){
+        int v = queue[front++];
+        for(int k=rfirst[v]; k<rfirst[v+1]; k++){
+            if(!(keep[rtail[k]] & 2)){
+                keep[rtail[k]] |= 2;
+                queue[rear++] = rtail[k];
+            }
+        }
+    }
+    free(rfirst);
+    free(rtail);
+
+    //Segments : one per kept edge, contraction adds at most one per removed vertex
+    int M = E + V + 1;
+    int segments = 0;
+    int *from = (int *)malloc(M*sizeof(int));
+    int *to = (int *)malloc(M*sizeof(int));
+    int *node = (int *)malloc(M*sizeof(int));
+    char *alive = (char *)malloc(M);
+    X->nodes = 0;
+    X->kind  = (char *)malloc(3*M);
+    X->left  = (int *)malloc(3*M*sizeof(int));
+    X->right = (int *)malloc(3*M*sizeof(int));
+    X->cap   = (CAP *)malloc(3*M*sizeof(CAP));
+    X->leaf  = (EDGE **)malloc(3*M*sizeof(EDGE *));
+
+    int *in = (int *)calloc(V + 1, sizeof(int)), *out = (int *)calloc(V + 1, sizeof(int));
+    int *inXor = (int *)calloc(V + 1, sizeof(int)), *outXor = (int *)calloc(V + 1, sizeof(int));
+    for(int i=1;i<=V;i++){
+        if(keep[i] != 3) continue;
+        for(EDGE *p = G->H[i].p; p!=NULL; p=p->next){
+            if(!CAP_POSITIVE(p->c) || p->y == i || keep[p->y] != 3) continue;
+            from[segments] = i;
+            to[segments] = p->y;
+            node[segments] = ReduceNode(X, REDUCE_LEAF, -1, -1, p);
+            alive[segments] = 1;
+            out[i]++;     outXor[i]    ^= segments;
+            in[p->y]++;   inXor[p->y]  ^= segments;
+            segments++;
+        }
+    }
+
+    //2) Contract chains, vertices whose degrees change are looked at again
+    rear = 0;
+    for(int v=1;v<=V;v++) if(keep[v] == 3 && in[v] == 1 && out[v] == 1 && v != s && v != t) queue[rear++] = v;
+    while(rear > 0){
+        int x = queue[--rear];
+        if(keep[x] != 3 || in[x] != 1 || out[x] != 1) continue;
+
+        int e1 = inXor[x], e2 = outXor[x];
+        int p = from[e1], q = to[e2];
+        alive[e1] = alive[e2] = 0;
+        keep[x] = 0;
+        out[p]--;   outXor[p] ^= e1;
+        in[q]--;    inXor[q]  ^= e2;
+        if(p != q){
+            from[segments] = p;
+            to[segments] = q;
+            node[segments] = ReduceNode(X, REDUCE_SERIES, node[e1], node[e2], NULL);
+            alive[segments] = 1;
+            out[p]++;   outXor[p] ^= segments;
+            in[q]++;    inXor[q]  ^= segments;
+            segments++;
+        }
+        if(p != s && p != t && in[p] == 1 && out[p] == 1) queue[rear++] = p;
+        if(q != p && q != s && q != t && in[q] == 1 && out[q] == 1) queue[rear++] = q;
+    }
+    keep[s] = keep[t] = 3;                              //Always present, even when t cannot be reached
+
+    //Renumber remaining vertices
+    X->vertex = (int *)calloc(V + 1, sizeof(int));
+    int n = 0;
+    for(int v=1;v<=V;v++) if(keep[v] == 3) X->vertex[v] = ++n;
+
+    //3) Group segments by (smaller, larger) vertex : counting sort by larger, then stable by smaller
+    int *count = (int *)calloc(V + 2, sizeof(int));
+    int *byLarger = (int *)malloc((segments + 1)*sizeof(int));
+    int *sorted = (int *)malloc((segments + 1)*sizeof(int));
+    for(int k=0;k<segments;k++) if(alive[k]) count[(from[k] > to[k] ? from[k] : to[k]) + 1]++;
+    for(int i=1;i<=V+1;i++) count[i] += count[i-1];
+    for(int k=0;k<segments;k++) if(alive[k]) byLarger[count[from[k] > to[k] ? from[k] : to[k]]++] = k;
+    int live = count[V+1];
+    memset(count, 0, (V + 2)*sizeof(int));
+    for(int i=0;i<live;i++){
+        int k = byLarger[i];
+        count[(from[k] < to[k] ? from[k] : to[k]) + 1]++;
+    }
+    for(int i=1;i<=V+1;i++) count[i] += count[i-1];
+    for(int i=0;i<live;i++){
+        int k = byLarger[i];
+        sorted[count[from[k] < to[k] ? from[k] : to[k]]++] = k;
+    }
+
+    X->pairs = 0;
+    X->arc = (int *)malloc((live + 1)*sizeof(int));
+    X->forward = (int *)malloc((live + 1)*sizeof(int));
+    X->backward = (int *)malloc((live + 1)*sizeof(int));
+    int *lo = byLarger, *hi = (int *)malloc((live + 1)*sizeof(int));   //byLarger is no longer needed
+    for(int i=0;i<live;){
+        int k = sorted[i];
+        int u = from[k] < to[k] ? from[k] : to[k], w = from[k] < to[k] ? to[k] : from[k];
+        int fwd = -1, bwd = -1;
+        for(; i<live && (from[sorted[i]] < to[sorted[i]] ? from[sorted[i]] : to[sorted[i]]) == u &&
+              (from[sorted[i]] < to[sorted[i]] ? to[sorted[i]] : from[sorted[i]]) == w; i++){
+            int j = sorted[i];
+            if(from[j] == u) fwd = fwd < 0 ? node[j] : ReduceNode(X, REDUCE_PARALLEL, fwd, node[j], NULL);
+            else             bwd = bwd < 0 ? node[j] : ReduceNode(X, REDUCE_PARALLEL, bwd, node[j], NULL);
+        }
+        lo[X->pairs] = X->vertex[u];
+        hi[X->pairs] = X->vertex[w];
+        X->forward[X->pairs] = fwd;
+        X->backward[X->pairs] = bwd;
+        X->pairs++;
+    }
+    STAT_ADD(reduceVerticesKept, n);
+    STAT_ADD(reduceEdgesKept, X->pairs);
+
+    //4) CSR residual network of the pairs
+    ARENA *arena = NewArena();
+    RESIDUAL *R = (RESIDUAL *)ArenaAlloc(arena, sizeof(RESIDUAL));
+    R->V = n;
+    R->A = 2*X->pairs;
+    R->first = (int *)ArenaCalloc(arena, n + 2, sizeof(int));
+    R->head  = (int *)ArenaAlloc(arena, (R->A + 1)*sizeof(int));
+    R->cap   = (CAP *)ArenaAlloc(arena, (R->A + 1)*sizeof(CAP));
+    R->flow  = (CAP *)ArenaCalloc(arena, R->A + 1, sizeof(CAP));
+    R->rev   = (int *)ArenaAlloc(arena, (R->A + 1)*sizeof(int));
+    R->edge  = (EDGE **)ArenaCalloc(arena, R->A + 1, sizeof(EDGE *));   //Arcs stand for nodes, not edges
+    R->cost  = NULL;
+    R->bk    = NULL;
+    R->deadline = 0;
+    R->steps = -1;
+    R->stopped = 0;
+    R->map = NULL;
+    R->mapSize = 0;
+    R->arena = arena;
+
+    for(int k=0;k<X->pairs;k++){
+        R->first[lo[k]+1]++;
+        R->first[hi[k]+1]++;
+    }
+    for(int i=1;i<=n+1;i++) R->first[i] += R->first[i-1];
+    for(int i=0;i<=n;i++) pos[i] = R->first[i];
+    for(int k=0;k<X->pairs;k++){
+        int a = pos[lo[k]]++, b = pos[hi[k]]++;
+        R->head[a] = hi[k];   R->cap[a] = X->forward[k]  >= 0 ? X->cap[X->forward[k]]  : 0;   R->rev[a] = b;
+        R->head[b] = lo[k];   R->cap[b] = X->backward[k] >= 0 ? X->cap[X->backward[k]] : 0;   R->rev[b] = a;
+        X->arc[k] = a;
+    }
+    X->R = R;
+
+    free(keep);
+    free(queue);
+    free(pos);
+    free(from);
+    free(to);
+    free(node);
+    free(alive);
+    free(in);
+    free(out);
+    free(inXor);
+    free(outXor);
+    free(count);
+    free(byLarger);
+    free(sorted);
+    free(hi);
+    return X;
+}
+
+int ReduceNode(REDUCTION *X, int kind, int left, int right, EDGE *leaf){
+
+    /*
+     * Arguments      : Pointer to reduction, kind of node (REDUCE_*), its two parts (series & parallel nodes), its edge (leaf)
+     * Task Performed : Appends the node & computes its capacity : capacity of the edge, smaller or sum of the parts
+     * Returns        : Index of the node
+    */
+
+    int k = X->nodes++;
+    X->kind[k]  = kind;
+    X->left[k]  = left;
+    X->right[k] = right;
+    X->leaf[k]  = leaf;
+    if(kind == REDUCE_LEAF)        X->cap[k] = leaf->c;
+    else if(kind == REDUCE_SERIES) X->cap[k] = X->cap[left] < X->cap[right] ? X->cap[left] : X->cap[right];
+    else                           X->cap[k] = X->cap[left] + X->cap[right];
+    return k;
+}
+
+void ExpandFlow(REDUCTION *X, GRAPH *G){
+
+    /*
+     * Arguments      : Pointer to reduction whose network has been solved, pointer to Graph
+     * Task Performed : 1) Sets flow of every edge to zero (removed edges carry no flow)
+     *                  2) The flow of every arc pair goes to its forward node if positive, to its backward node otherwise
+     *                  3) Walks node trees with an explicit stack : a series node gives its flow to both parts, a parallel
+     *                     node fills its left part up to capacity & gives the rest to its right part, a leaf sets EDGE::f
+     * Returns        : void
+    */
+
+    for(int i=1;i<=G->V;i++){
+        for(EDGE *p = G->H[i].p; p!=NULL; p=p->next) p->f = 0;
+    }
+
+    int *stack = (int *)malloc((X->nodes + 1)*sizeof(int));
+    CAP *amount = (CAP *)malloc((X->nodes + 1)*sizeof(CAP));
+    for(int k=0;k<X->pairs;k++){
+
+        CAP f = X->R->flow[X->arc[k]];
+        int top = 0;
+        if(CAP_POSITIVE(f)){
+            stack[top] = X->forward[k];
+            amount[top++] = f;
+        }
+        else if(CAP_POSITIVE(-f)){
+            stack[top] = X->backward[k];
+            amount[top++] = -f;
+        }
+
+        while(top > 0){
+            int v = stack[--top];
+            f = amount[top];
+            if(X->kind[v] == REDUCE_LEAF) X->leaf[v]->f = f;
+            else if(X->kind[v] == REDUCE_SERIES){
+                stack[top] = X->left[v];    amount[top++] = f;
+                stack[top] = X->right[v];   amount[top++] = f;
+            }
+            else{
+                CAP part = f < X->cap[X->left[v]] ? f : X->cap[X->left[v]];
+                stack[top] = X->left[v];    amount[top++] = part;
+                stack[top] = X->right[v];   amount[top++] = f - part;
+            }
+        }
+    }
+    free(stack);
+    free(amount);
+}
+
+void FreeReduction(REDUCTION *X){
+
+    FreeResidual(X->R);
+    free(X->vertex);
+    free(X->arc);
+    free(X->forward);
+    free(X->backward);
+    free(X->kind);
+    free(X->left);
+    free(X->right);
+    free(X->cap);
+    free(X->leaf);
+    free(X);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+/* --- Vertex Reordering Functions (memory locality of vertex & arc arrays) --*/
+
+void ReorderGraph(GRAPH *G, int method){
+
+    /*
+     * Arguments      : Pointer to Graph (as read, before any solve), reordering method (REORDER_*)
+     * Task Performed : 1) Builds the undirected adjacency (both directions of every edge with positive capacity) in CSR form
+     *                  2) Computes the new order of the vertices :
+     *                     bfs    : breadth first search from vertex 1, then from the lowest unvisited vertex of every
+     *                              other component, so that neighbours get close ids
+     *                     rcm    : Cuthill-McKee (breadth first search starting at a vertex of lowest degree of every
+     *                              component, unvisited neighbours taken by increasing degree), reversed
+     *                     degree : decreasing degree, ties in file order
+     *                     Hubs (more than REORDER_HUB times the average degree, like the terminals of a vision grid)
+     *                     are left out of both searches, otherwise they would hand their neighbours out in file order
+     *                  3) Moves H[order[k]] to H[k] & renames the end vertex of every edge, adjacency lists keep their
+     *                     order. H[k].x keeps the id of the file & G->rank maps file ids to vertices (InternalId)
+     *                  The residual network, built afterwards, then places the arcs of neighbouring vertices close together
+     * Returns        : void
+     * NOTE           : A residual network read from a binary file is released & rebuilt in the new order by the next solve
+    */
+
+    if(method == REORDER_NONE || G->V < 2) return;
+    STAT(double startTime = WallTime();)
+
+    int n = G->V;
+    int *first = (int *)calloc(n + 2, sizeof(int));
+    for(int i=1;i<=n;i++){
+        for(EDGE *p = G->H[i].p; p!=NULL; p=p->next){
+            if(!CAP_POSITIVE(p->c) || p->y == i) continue;
+            first[i+1]++;
+            first[p->y+1]++;
+        }
+    }
+    for(int i=1;i<=n+1;i++) first[i] += first[i-1];
+
+    int *adj = (int *)malloc((first[n+1] + 1)*sizeof(int));
+    int *pos = (int *)malloc((n + 1)*sizeof(int));
+    for(int i=0;i<=n;i++) pos[i] = first[i];
+    for(int i=1;i<=n;i++){
+        for(EDGE *p = G->H[i].p; p!=NULL; p=p->next){
+            if(!CAP_POSITIVE(p->c) || p->y == i) continue;
+            adj[pos[i]++] = p->y;
+            adj[pos[p->y]++] = i;
+        }
+    }
+
+    int *order = (int *)malloc((n + 1)*sizeof(int));      //order[k] stores the vertex placed at k
+    int *rank  = (int *)calloc(n + 1, sizeof(int));       //rank[v] stores the new id of vertex v (0 while unplaced)
+
+    //Vertices by increasing degree (counting sort, stable), used by degree & rcm
+    int maxDegree = 0;
+    for(int v=1;v<=n;v++) if(first[v+1] - first[v] > maxDegree) maxDegree = first[v+1] - first[v];
+    int *bucket = (int *)calloc(maxDegree + 2, sizeof(int));
+    int *byDegree = (int *)malloc((n + 1)*sizeof(int));
+    for(int v=1;v<=n;v++) bucket[first[v+1] - first[v] + 1]++;
+    for(int d=1;d<=maxDegree+1;d++) bucket[d] += bucket[d-1];
+    for(int v=1;v<=n;v++) byDegree[++bucket[first[v+1] - first[v]]] = v;   //byDegree[1 .. n]
+
+    int hub = REORDER_HUB*(first[n+1]/n + 1);           //Degree above which a vertex is not searched through
+
+    if(method == REORDER_DEGREE){
+        //Decreasing degree, vertices of equal degree keep file order
+        int k = 0;
+        for(int hi=n; hi>=1; ){
+            int lo = hi;
+            int d = first[byDegree[hi]+1] - first[byDegree[hi]];
+            while(lo > 1 && first[byDegree[lo-1]+1] - first[byDegree[lo-1]] == d) lo--;
+            for(int j=lo;j<=hi;j++) order[++k] = byDegree[j];
+            hi = lo - 1;
+        }
+    }
+    else{
+        long long *key = (long long *)malloc((maxDegree + 1)*sizeof(long long));
+        int placed = 0;
+        for(int r=1;r<=n;r++){
+
+            int root = method == REORDER_RCM ? byDegree[r] : r;
+            if(rank[root]) continue;
+            rank[root] = -1;                            //Taken, ids are given once the order is complete
+            order[++placed] = root;
+
+            for(int front=placed; front<=placed; front++){
+                int v = order[front];
+                int found = 0;
+                if(first[v+1] - first[v] > hub) continue;
+                for(int a=first[v]; a<first[v+1]; a++){
+                    int w = adj[a];
+                    if(rank[w] || first[w+1] - first[w] > hub) continue;
+                    rank[w] = -1;
+                    if(method == REORDER_BFS) order[++placed] = w;
+                    else key[found++] = (long long)(first[w+1] - first[w]) << 32 | w;
+                }
+                if(method == REORDER_RCM){
+                    qsort(key, found, sizeof(long long), CompareLong);
+                    for(int j=0;j<found;j++) order[++placed] = (int)(key[j] & 0xFFFFFFFF);
+                }
+            }
+        }
+        free(key);
+
+        if(method == REORDER_RCM){
+            for(int k=1;k<=n/2;k++){
+                int swap = order[k];
+                order[k] = order[n+1-k];
+                order[n+1-k] = swap;
+            }
+        }
+    }
+    for(int k=1;k<=n;k++) rank[order[k]] = k;
+
+    //Relabel : vertex order[k] becomes vertex k
+    VERTEX *H = (VERTEX *)ArenaAlloc(G->arena, (n + 1)*sizeof(VERTEX));     //Old array stays in the arena
+    H[0] = G->H[0];
+    for(int k=1;k<=n;k++) H[k] = G->H[order[k]];
+    for(int k=1;k<=n;k++){
+        for(EDGE *p = H[k].p; p!=NULL; p=p->next) p->y = rank[p->y];
+    }
+    G->H = H;
+
+    //rank of the graph goes from file ids to vertices, room is left for the universal source & sink of need based flow
+    int *fileRank = (int *)ArenaAlloc(G->arena, (n + 3)*sizeof(int));
+    for(int x=1;x<=n;x++) fileRank[x] = rank[G->rank != NULL ? G->rank[x] : x];
+    fileRank[0] = 0;
+    fileRank[n+1] = n + 1;
+    fileRank[n+2] = n + 2;
+    G->rank = fileRank;
+
+    if(G->R != NULL){
+        FreeResidual(G->R);
+        G->R = NULL;
+    }
+
+    free(first);
+    free(adj);
+    free(pos);
+    free(order);
+    free(rank);
+    free(bucket);
+    free(byDegree);
+    STAT(STAT_TIME(reorderTime, startTime);)
+}
+
+int ParseReorder(char *name){
+
+    /*
+     * Arguments      : Character pointer to reordering name (none | bfs | rcm | degree)
+     * Task Performed : Maps reordering name to REORDER_* value, exits on unknown name
+     * Returns        : Reordering method
+    */
+
+    if(strcmp(name,"none")==0)   return REORDER_NONE;
+    if(strcmp(name,"bfs")==0)    return REORDER_BFS;
+    if(strcmp(name,"rcm")==0)    return REORDER_RCM;
+    if(strcmp(name,"degree")==0) return REORDER_DEGREE;
+
+    printf("Unknown reordering %s (expected none | bfs | rcm | degree).\n",name);
+    exit(0);
+}
+
+char *ReorderName(int method){
+
+    if(method == REORDER_BFS)    return "bfs";
+    if(method == REORDER_RCM)    return "rcm";
+    if(method == REORDER_DEGREE) return "degree";
+    return "none";
+}
+
+int CompareLong(const void *a, const void *b){
+
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+/* --- Batch Mode Functions (non interactive jobs with buffered output) --*/
+
+int RunBatch(BATCHJOB *job, int count, char *outFile){
+
+    /*
+     * Arguments      : Array of jobs, number of jobs, character pointer to output File Name (NULL : standard output)
+     * Task Performed : Gives the output stream a buffer of OUTPUT_BUFFER bytes, so that results are written in large blocks
+     *                  instead of one write per line, & runs the jobs in order with RunBatchJob, or concurrently with
+     *                  RunPool when more than one thread is given (results are written in job order either way)
+     * Returns        : Number of jobs that failed (wrote an error line)
+    */
+
+    FILE *out = stdout;
+    if(outFile != NULL && (out = fopen(outFile, "wb")) == NULL){
+        printf("Could not open file %s.\n",outFile);
+        exit(0);
+    }
+    char *buffer = (char *)malloc(OUTPUT_BUFFER);
+    setvbuf(out, buffer, _IOFBF, OUTPUT_BUFFER);
+
+    int failed = 0;
+    if(Threads > 1 && count > 1) failed = RunPool(job, count, out);
+    else for(int i=0;i<count;i++) failed += RunBatchJob(&job[i], out);
+
+    if(out == stdout){
+        fflush(out);
+        setvbuf(out, NULL, _IOLBF, BUFSIZ);         //stdout outlives the buffer
+    }
+    else fclose(out);
+    free(buffer);
+    return failed;
+}
+
+int ReadManifest(char *fname, BATCHJOB **job, int task, int output){
+
+    /*
+     * Arguments      : Character pointer to manifest File Name, pointer to job array to fill, default task & output
+     * Task Performed : Reads one job per line : file s t [task] [output], task being max | need | both & output being
+     *                  value | nonzero | cut | binary (defaults are those given by -task & -out). Empty lines & lines
+     *                  starting with # are skipped
+     * Returns        : Number of jobs read
+    */
+
+    FILE *fptr = fopen(fname, "r");
+    if (fptr == NULL){
+        printf("Could not open file %s.\n",fname);
+        exit(0);
+    }
+
+    int count = 0, size = 16;
+    *job = (BATCHJOB *)malloc(size*sizeof(BATCHJOB));
+    char line[8192], file[4096], taskName[16], outputName[16];
+
+    while(fgets(line, sizeof(line), fptr) != NULL){
+
+        int s, t;
+        int fields = sscanf(line, "%4095s %d %d %15s %15s", file, &s, &t, taskName, outputName);
+        if(fields <= 0 || file[0] == '#') continue;
+        if(fields < 3){
+            printf("Bad manifest line : %s", line);
+            exit(0);
+        }
+
+        if(count == size){
+            size *= 2;
+            *job = (BATCHJOB *)realloc(*job, size*sizeof(BATCHJOB));
+        }
+        BATCHJOB *j = &(*job)[count++];
+        j->file   = strdup(file);
+        j->s      = s;
+        j->t      = t;
+        j->task   = fields >= 4 ? ParseTask(taskName) : task;
+        j->output = fields >= 5 ? ParseOutput(outputName) : output;
+    }
+
+    fclose(fptr);
+    return count;
+}
+
+int RunBatchJob(BATCHJOB *job, FILE *out){
+
+    /*
+     * Arguments      : Pointer to job, output stream
+     * Task Performed : 1) Reads the graph once (& reorders its vertices when -reorder is given), a file that cannot be
+     *                     read gives the error line "error file message" instead of any result
+     *                  2) Max flow task : solves from s to t with SolveMaxFlow (source or sink outside the graph gives
+     *                     an error line instead)
+     *                  3) Need based flow task : starts again from zero flow, adds universal source & sink, solves & makes
+     *                     the flow of minimum cost when edges have costs
+     *                  4) Writes the result of every task with WriteBatchResult & the time spent on each step with
+     *                     WriteBatchTime
+     * Returns        : 1 if the job wrote an error line, 0 if not
+    */
+
+    double start = WallTime(), load, max = 0, need = 0;
+    char error[LOAD_ERROR];
+    GRAPH *G = LoadGraph(job->file, error);
+    if(G == NULL){
+        if(job->output != OUTPUT_BINARY) fprintf(out, "error %s %s\n", job->file, error);
+        return 1;
+    }
+    ReorderGraph(G, Reorder);
+    int failed = 0;
+    int V = G->V;                                   //Vertices of the graph as read, without universal source & sink
+    load = WallTime() - start;
+
+    if(job->task & TASK_MAX){
+        if(job->s < 1 || job->s > V || job->t < 1 || job->t > V || job->s == job->t){
+            if(job->output != OUTPUT_BINARY) fprintf(out, "error %s source %d sink %d not valid\n", job->file, job->s, job->t);
+            failed = 1;
+        }
+        else{
+            start = WallTime();
+            int s = InternalId(G,job->s);
+            CAP upper = 0;
+            CAP value = Budget > 0 || StepBudget > 0 ? BoundedMaxFlow(G,s,InternalId(G,job->t),&upper) : SolveMaxFlow(G,s,InternalId(G,job->t));
+            max = WallTime() - start;
+            if(job->output != OUTPUT_VALUE && G->R == NULL) G->R = BuildResidual(G);   //Carries the flow of the edges
+            WriteBatchResult(out, G, G->R, job, TASK_MAX, s, V, value, 1);
+            if(Budget > 0 || StepBudget > 0) WriteBatchBound(out, job, value, upper);
+        }
+    }
+
+    if(job->task & TASK_NEED){
+        start = WallTime();
+        ResetFlow(G);
+        STAT(double startNeed = WallTime();)
+        int added = AddNeedEdges(G);
+        STAT(STAT_TIME(needTime, startNeed);)
+
+        CAP value = added ? SolveMaxFlow(G,G->V-1,G->V) : 0;
+        int feasible = added && checkFeasibility(G);
+        if(feasible && G->W){
+            if(G->R == NULL) G->R = BuildResidual(G);
+            MinCostCirculation(G->R);
+            WriteBackFlow(G->R);
+        }
+        need = WallTime() - start;
+        if(added && G->R == NULL) G->R = BuildResidual(G);
+        WriteBatchResult(out, G, added ? G->R : NULL, job, TASK_NEED, G->V-1, V, value, feasible);
+    }
+
+    WriteBatchTime(out, job, load, max, need);
+    DestroyGraph(G);
+    return failed;
+}
+
+void WriteBatchResult(FILE *out, GRAPH *G, RESIDUAL *R, BATCHJOB *job, int task, int s, int V, CAP value, int feasible){
+
+    /*
+     * Arguments      : Output stream, pointer to Graph, residual network of G holding the flow of the task (NULL : zero
+     *                  flow, read only when edges are written), pointer to job, task (TASK_MAX | TASK_NEED), source s
+     *                  of the solve, number of vertices V of the graph as read, flow value, feasibility of need based flow
+     * Task Performed : 1) Text outputs start with one line per task :
+     *                       max  : "max file s t value"
+     *                       need : "need file feasible value [cost]" or "need file infeasible value"
+     *                     followed by "x y f" for every edge with non zero flow (nonzero) or "x y c" for every edge
+     *                     of the minimum cut (cut). Only edges between vertices 1 .. V are written, in the numbering
+     *                     & order of the input file. For need based flow the lines follow only a feasible result & the
+     *                     cut separates the universal source side
+     *                  2) Binary output writes the header (FLOWDUMP_MAGIC, CAP_CODE, task, feasible, V, E) as ints,
+     *                     value as CAP, then for each of the E edges x & y as ints & f as CAP, in adjacency list order
+     * Returns        : void
+    */
+
+    int output = job->output;
+    if(output == OUTPUT_BINARY){
+        int E = 0;
+        for(int i=1;i<=V;i++){
+            for(EDGE *p = G->H[i].p; p!=NULL; p=p->next) if(p->y <= V) E++;
+        }
+        int header[6] = {FLOWDUMP_MAGIC, CAP_CODE, task, feasible, V, E};
+        fwrite(header, sizeof(int), 6, out);
+        fwrite(&value, sizeof(CAP), 1, out);
+        for(int x=1;x<=V;x++){
+            int i = InternalId(G,x);
+            int a = R != NULL ? R->first[i] : 0;
+            for(EDGE *p = G->H[i].p; p!=NULL; p=p->next){
+                if(p->y > V) continue;
+                CAP f = EdgeFlow(R, p, &a);
+                fwrite(&x, sizeof(int), 1, out);
+                fwrite(&G->H[p->y].x, sizeof(int), 1, out);
+                fwrite(&f, sizeof(CAP), 1, out);
+            }
+        }
+        return;
+    }
+
+    if(task == TASK_MAX) fprintf(out, "max %s %d %d " CAP_FMT "\n", job->file, job->s, job->t, value);
+    else{
+        fprintf(out, "need %s %s " CAP_FMT, job->file, feasible ? "feasible" : "infeasible", value);
+        if(feasible && G->W){
+            COSTSUM cost = 0;
+            for(int i=1;i<=V;i++){
+                int a = R != NULL ? R->first[i] : 0;
+                for(EDGE *p = G->H[i].p; p!=NULL; p=p->next) if(p->y <= V) cost += (COSTSUM)EdgeFlow(R, p, &a)*p->w;
+            }
+            fprintf(out, " " COST_FMT, cost);
+        }
+        fprintf(out, "\n");
+        if(!feasible) return;
+    }
+
+    if(output == OUTPUT_NONZERO){
+        for(int x=1;x<=V;x++){
+            int i = InternalId(G,x);
+            int a = R != NULL ? R->first[i] : 0;
+            for(EDGE *p = G->H[i].p; p!=NULL; p=p->next){
+                if(p->y > V) continue;
+                CAP f = EdgeFlow(R, p, &a);
+                if(!CAP_EQUAL(f,0)) fprintf(out, "%d %d " CAP_FMT "\n", x, G->H[p->y].x, f);
+            }
+        }
+    }
+    else if(output == OUTPUT_CUT) WriteMinCut(out, G, R, s, V);
+}
+
+void WriteBatchTime(FILE *out, BATCHJOB *job, double load, double max, double need){
+
+    /*
+     * Arguments      : Output stream, pointer to job, wall time (seconds) spent reading the graph, solving the max flow
+     *                  task & the need based flow task
+     * Task Performed : Writes "time file s t load L max M need N" after the results of a job (nothing for binary output)
+     * Returns        : void
+    */
+
+    if(job->output == OUTPUT_BINARY) return;
+    fprintf(out, "time %s %d %d load %.6f max %.6f need %.6f\n", job->file, job->s, job->t, load, max, need);
+}
+
+void WriteBatchBound(FILE *out, BATCHJOB *job, CAP lower, CAP upper){
+
+    /*
+     * Arguments      : Output stream, pointer to job, flow found & upper bound on the maximum flow
+     * Task Performed : Writes "bound file s t lower L upper U gap G" after the max flow result when -budget or -steps is
+     *                  given, G is the percentage of U not covered by L (0 when the engine finished). Not written for
+     *                  binary output
+     * Returns        : void
+    */
+
+    if(job->output == OUTPUT_BINARY) return;
+    if(upper < lower) upper = lower;
+    fprintf(out, "bound %s %d %d lower " CAP_FMT " upper " CAP_FMT " gap %.2f\n", job->file, job->s, job->t, lower, upper,
+            CAP_POSITIVE(upper) ? 100.0*(upper - lower)/upper : 0.0);
+}
+
+CAP EdgeFlow(RESIDUAL *R, EDGE *p, int *a){
+
+    /*
+     * Arguments      : Residual network holding a flow (NULL : zero flow), edge p leaving vertex i, cursor *a over the
+     *                  arcs of i (starting at first[i])
+     * Task Performed : BuildResidual places the forward arcs of i in the order of its adjacency list, so walking the list
+     *                  while moving the cursor finds the arc of every edge (edges of zero capacity have no arc)
+     * Returns        : Flow of edge p
+    */
+
+    if(R == NULL || !CAP_POSITIVE(p->c)) return 0;
+    while(R->edge[*a] != p) (*a)++;
+    return R->flow[*a];
+}
+
+void WriteMinCut(FILE *out, GRAPH *G, RESIDUAL *R, int s, int V){
+
+    /*
+     * Arguments      : Output stream, pointer to Graph, its residual network R solved from source s, number of vertices V
+     *                  whose edges are written
+     * Task Performed : Finds the vertices reachable from s by arcs with residual capacity (side of s of a minimum cut) by BFS,
+     *                  & writes "x y c" for every edge from that side to the other one with both ends in 1 .. V
+     * Returns        : void
+    */
+
+    char *side = (char *)calloc(R->V + 1, 1);
+    int *queue = (int *)malloc((R->V + 1)*sizeof(int));
+    int front = 0, rear = 0;
+
+    side[s] = 1;
+    queue[rear++] = s;
+    while(front < rear){
+        int v = queue[front++];
+        for(int a=R->first[v]; a<R->first[v+1]; a++){
+            int w = R->head[a];
+            if(!side[w] && CAP_POSITIVE(R->cap[a] - R->flow[a])){
+                side[w] = 1;
+                queue[rear++] = w;
+            }
+        }
+    }
+
+    for(int x=1;x<=V;x++){
+        int i = InternalId(G,x);
+        if(!side[i]) continue;
+        for(EDGE *p = G->H[i].p; p!=NULL; p=p->next){
+            if(p->y <= V && !side[p->y] && CAP_POSITIVE(p->c)) fprintf(out, "%d %d " CAP_FMT "\n", x, G->H[p->y].x, p->c);
+        }
+    }
+
+    free(side);
+    free(queue);
+}
+
+int RunPool(BATCHJOB *job, int count, FILE *out){
+
+    /*
+     * Arguments      : Array of jobs, number of jobs, output stream
+     * Task Performed : 1) Groups the jobs by graph file name, so that every file is read once
+     *                  2) Starts Threads workers, each with a task queue. Loading a file is one task (PoolLoadFile), the
+     *                     load tasks are dealt to the queues in turn. A load task pushes one solve task (PoolSolveJob) per
+     *                     job of the file on the queue of its worker, from which idle workers steal them
+     *                  3) Engines run with one thread inside the pool (the parallel push-relabel engine is replaced by the
+     *                     sequential one), the jobs are what runs in parallel
+     *                  Results of every job go to the stream in job order as soon as every earlier job is written
+     * Returns        : Number of jobs that failed (wrote an error line)
+     * NOTE           : Max flow tasks of the pool run the selected engine (Dinic for unit graphs without -e) on their own
+     *                  flow array, Hopcroft-Karp & -reduce, which write their flow on the shared edges, are not used
+    */
+
+    JOBPOOL P;
+    P.job = job;
+    P.count = count;
+    P.out = out;
+    P.written = 0;
+    P.text   = (char **)calloc(count, sizeof(char *));
+    P.length = (size_t *)calloc(count, sizeof(size_t));
+    P.fileOf = (int *)malloc(count*sizeof(int));
+    pthread_mutex_init(&P.outLock, NULL);
+    atomic_init(&P.failed, 0);
+
+    //Jobs naming the same file are adjacent once sorted, ties keep the job order
+    BATCHJOB **order = (BATCHJOB **)malloc(count*sizeof(BATCHJOB *));
+    for(int j=0;j<count;j++) order[j] = &job[j];
+    qsort(order, count, sizeof(BATCHJOB *), CompareJobFile);
+
+    P.file = (POOLFILE *)calloc(count, sizeof(POOLFILE));
+    P.files = 0;
+    int *jobIndex = (int *)malloc(count*sizeof(int));
+    for(int k=0;k<count;k++){
+        if(k == 0 || strcmp(order[k]->file, order[k-1]->file) != 0){
+            POOLFILE *F = &P.file[P.files++];
+            F->name = order[k]->file;
+            F->job  = jobIndex + k;
+        }
+        POOLFILE *F = &P.file[P.files - 1];
+        int j = order[k] - job;
+        F->job[F->jobs++] = j;
+        F->task |= job[j].task;
+        P.fileOf[j] = P.files - 1;
+    }
+    for(int f=0;f<P.files;f++) atomic_init(&P.file[f].users, P.file[f].jobs);
+    free(order);
+
+    int saved = Threads, savedEngine = Engine;
+    P.threads = Threads;
+    Threads = 1;                                    //Jobs already run in parallel, their engines stay sequential
+    if(Engine == ENGINE_PARALLEL_PR) Engine = ENGINE_PUSH_RELABEL;
+
+    P.queue = (POOLQUEUE *)malloc(P.threads*sizeof(POOLQUEUE));
+    for(int i=0;i<P.threads;i++){
+        POOLQUEUE *Q = &P.queue[i];
+        Q->size = 16;
+        Q->task = (POOLTASK *)malloc(Q->size*sizeof(POOLTASK));
+        Q->head = Q->tail = 0;
+        Q->pool = &P;
+        Q->id = i;
+        pthread_mutex_init(&Q->lock, NULL);
+    }
+    atomic_init(&P.pending, P.files);
+    atomic_init(&P.pushes, 0);
+    pthread_mutex_init(&P.idleLock, NULL);
+    pthread_cond_init(&P.idle, NULL);
+    for(int f=0;f<P.files;f++){
+        POOLQUEUE *Q = &P.queue[f % P.threads];
+        Q->task[Q->tail].kind = POOL_TASK_LOAD;     //Counted in pending above, so workers cannot stop before they run
+        Q->task[Q->tail].index = f;
+        if(++Q->tail == Q->size){
+            Q->size *= 2;
+            Q->task = (POOLTASK *)realloc(Q->task, Q->size*sizeof(POOLTASK));
+        }
+    }
+
+    pthread_t *worker = (pthread_t *)malloc(P.threads*sizeof(pthread_t));
+    for(int i=1;i<P.threads;i++) pthread_create(&worker[i], NULL, PoolWorker, &P.queue[i]);
+    PoolWorker(&P.queue[0]);
+    for(int i=1;i<P.threads;i++) pthread_join(worker[i], NULL);
+
+    Threads = saved;
+    Engine = savedEngine;
+    for(int i=0;i<P.threads;i++){
+        free(P.queue[i].task);
+        pthread_mutex_destroy(&P.queue[i].lock);
+    }
+    pthread_mutex_destroy(&P.outLock);
+    pthread_mutex_destroy(&P.idleLock);
+    pthread_cond_destroy(&P.idle);
+    free(worker);
+    free(P.queue);
+    free(P.file);
+    free(jobIndex);
+    free(P.fileOf);
+    free(P.text);
+    free(P.length);
+    return atomic_load(&P.failed);
+}
+
+void *PoolWorker(void *arg){
+
+    /*
+     * Arguments      : Pointer to the task queue of the worker
+     * Task Performed : Runs tasks from its own queue, or stolen from the others, until no task is left in the pool.
+     *                  A worker that finds every queue empty sleeps on the idle condition until a running task pushes a
+     *                  new one (pushes changed since it looked) or the last task finishes
+     * Returns        : NULL
+    */
+
+    POOLQUEUE *Q = (POOLQUEUE *)arg;
+    JOBPOOL *P = Q->pool;
+    POOLTASK task;
+
+    while(1){
+        long seen = atomic_load(&P->pushes);
+        if(PoolTake(P, Q->id, &task)){
+            if(task.kind == POOL_TASK_LOAD) PoolLoadFile(P, task.index, Q);
+            else                            PoolSolveJob(P, task.index);
+            if(atomic_fetch_sub(&P->pending, 1) == 1){
+                pthread_mutex_lock(&P->idleLock);     //Under the lock, so a worker about to sleep sees pending or the wake up
+                pthread_cond_broadcast(&P->idle);
+                pthread_mutex_unlock(&P->idleLock);
+            }
+            continue;
+        }
+        pthread_mutex_lock(&P->idleLock);
+        while(atomic_load(&P->pending) > 0 && atomic_load(&P->pushes) == seen) pthread_cond_wait(&P->idle, &P->idleLock);
+        int done = atomic_load(&P->pending) == 0;
+        pthread_mutex_unlock(&P->idleLock);
+        if(done) break;
+    }
+    return NULL;
+}
+
+void PoolPush(POOLQUEUE *Q, int kind, int index){
+
+    atomic_fetch_add(&Q->pool->pending, 1);         //Before the task can be taken, so pending never drops to 0 early
+    pthread_mutex_lock(&Q->lock);
+    if(Q->tail == Q->size){
+        if(Q->head > 0){                            //Reuse room left by stolen tasks
+            memmove(Q->task, Q->task + Q->head, (Q->tail - Q->head)*sizeof(POOLTASK));
+            Q->tail -= Q->head;
+            Q->head = 0;
+        }
+        if(Q->tail == Q->size){
+            Q->size *= 2;
+            Q->task = (POOLTASK *)realloc(Q->task, Q->size*sizeof(POOLTASK));
+        }
+    }
+    Q->task[Q->tail].kind = kind;
+    Q->task[Q->tail].index = index;
+    Q->tail++;
+    pthread_mutex_unlock(&Q->lock);
+
+    JOBPOOL *P = Q->pool;
+    pthread_mutex_lock(&P->idleLock);               //Wake one sleeping worker to steal the task
+    atomic_fetch_add(&P->pushes, 1);
+    pthread_cond_signal(&P->idle);
+    pthread_mutex_unlock(&P->idleLock);
+}
+
+int PoolTake(JOBPOOL *P, int id, POOLTASK *task){
+
+    /*
+     * Arguments      : Pointer to job pool, id of the calling worker, pointer to the task to fill
+     * Task Performed : Takes the newest task of the worker's own queue, or else steals the oldest task of the next non
+     *                  empty queue (id+1, id+2, ..)
+     * Returns        : 1 if a task was taken, 0 if every queue was empty
+    */
+
+    POOLQUEUE *Q = &P->queue[id];
+    pthread_mutex_lock(&Q->lock);
+    if(Q->tail > Q->head){
+        *task = Q->task[--Q->tail];
+        pthread_mutex_unlock(&Q->lock);
+        return 1;
+    }
+    pthread_mutex_unlock(&Q->lock);
+
+    for(int k=1;k<P->threads;k++){
+        POOLQUEUE *V = &P->queue[(id + k) % P->threads];
+        pthread_mutex_lock(&V->lock);
+        if(V->tail > V->head){
+            *task = V->task[V->head++];
+            pthread_mutex_unlock(&V->lock);
+            return 1;
+        }
+        pthread_mutex_unlock(&V->lock);
+    }
+    return 0;
+}
+
+void PoolLoadFile(JOBPOOL *P, int f, POOLQUEUE *Q){
+
+    /*
+     * Arguments      : Pointer to job pool, index of the file, queue of the calling worker
+     * Task Performed : 1) Reads the graph & builds its residual network when some job has a max flow task (the network
+     *                     is kept apart from G->R, which AddNeedEdges rebuilds)
+     *                  2) When some job has a need based flow task, solves it on the graph as in RunBatchJob & keeps
+     *                     value, feasibility & the residual network holding its flow
+     *                  3) Pushes one solve task per job of the file on the worker's queue
+     *                  A file that cannot be read gives the error line of RunBatchJob to each of its jobs instead
+     * Returns        : void
+    */
+
+    POOLFILE *F = &P->file[f];
+    double start = WallTime();
+    char error[LOAD_ERROR];
+    F->G = LoadGraph(F->name, error);
+    if(F->G == NULL){
+        for(int i=0;i<F->jobs;i++){
+            int j = F->job[i];
+            char *text = NULL;
+            size_t length = 0;
+            FILE *out = open_memstream(&text, &length);
+            if(P->job[j].output != OUTPUT_BINARY) fprintf(out, "error %s %s\n", F->name, error);
+            fclose(out);
+            atomic_fetch_sub(&F->users, 1);         //Nothing to release, the job is finished
+            atomic_fetch_add(&P->failed, 1);
+            PoolEmit(P, j, text, length);
+        }
+        return;
+    }
+    ReorderGraph(F->G, Reorder);
+    F->V = F->G->V;
+    F->unit = F->G->U;
+    F->R = NULL;
+    if(F->task & TASK_MAX){
+        F->R = F->G->R != NULL ? F->G->R : BuildResidual(F->G);
+        F->G->R = NULL;
+    }
+    F->loadTime = WallTime() - start;
+
+    if(F->task & TASK_NEED){
+        start = WallTime();
+        GRAPH *G = F->G;
+        int added = AddNeedEdges(G);
+        F->needValue = added ? SolveMaxFlow(G,G->V-1,G->V) : 0;
+        F->feasible = added && checkFeasibility(G);
+        if(added && G->R == NULL) G->R = BuildResidual(G);
+        if(F->feasible && G->W){
+            MinCostCirculation(G->R);
+            WriteBackFlow(G->R);
+        }
+        F->needTime = WallTime() - start;
+    }
+
+    for(int i=F->jobs-1;i>=0;i--) PoolPush(Q, POOL_TASK_SOLVE, F->job[i]);     //Owner takes the first job first
+}
+
+void PoolSolveJob(JOBPOOL *P, int j){
+
+    /*
+     * Arguments      : Pointer to job pool, index of the job
+     * Task Performed : 1) Max flow task : copies the RESIDUAL struct of the file with a zeroed flow array of its own &
+     *                     runs the engine on it (Dinic for unit capacity graphs when no engine was chosen with -e)
+     *                  2) Need based flow task : writes the result solved once for the file
+     *                  3) Writes results & timing line into a memory stream, which PoolEmit moves to the batch stream.
+     *                     The last job of the file releases its graph & residual network
+     * Returns        : void
+    */
+
+    BATCHJOB *job = &P->job[j];
+    POOLFILE *F = &P->file[P->fileOf[j]];
+    char *text = NULL;
+    size_t length = 0;
+    FILE *out = open_memstream(&text, &length);
+    double max = 0;
+
+    if(job->task & TASK_MAX){
+        if(job->s < 1 || job->s > F->V || job->t < 1 || job->t > F->V || job->s == job->t){
+            if(job->output != OUTPUT_BINARY) fprintf(out, "error %s source %d sink %d not valid\n", job->file, job->s, job->t);
+            atomic_fetch_add(&P->failed, 1);
+        }
+        else{
+            double start = WallTime();
+            RESIDUAL R = *F->R;                     //Arrays shared, flow of its own
+            R.flow = (CAP *)calloc(R.A + 1, sizeof(CAP));
+            R.bk = NULL;
+            SetBudget(&R);
+            int s = InternalId(F->G,job->s), t = InternalId(F->G,job->t);
+            RunEngine(&R, s, t, F->unit && !EngineChosen ? ENGINE_DINIC : Engine);
+            CAP value = FlowValue(&R, s);
+            STAT_ADD(solves, 1);
+            max = WallTime() - start;
+            WriteBatchResult(out, F->G, &R, job, TASK_MAX, s, F->V, value, 1);
+            if(Budget > 0 || StepBudget > 0) WriteBatchBound(out, job, value, R.stopped ? CutBound(&R, s, t) : value);
+            FreeSearchTrees(&R);
+            free(R.flow);
+        }
+    }
+    if(job->task & TASK_NEED){
+        WriteBatchResult(out, F->G, F->G->R, job, TASK_NEED, F->V + 1, F->V, F->needValue, F->feasible);
+    }
+    WriteBatchTime(out, job, F->loadTime, max, job->task & TASK_NEED ? F->needTime : 0);
+    fclose(out);
+
+    if(atomic_fetch_sub(&F->users, 1) == 1){
+        if(F->R != NULL) FreeResidual(F->R);
+        DestroyGraph(F->G);
+    }
+    PoolEmit(P, j, text, length);
+}
+
+void PoolEmit(JOBPOOL *P, int j, char *text, size_t length){
+
+    /*
+     * Arguments      : Pointer to job pool, index of a finished job, its output & output length
+     * Task Performed : Keeps the output of job j, then writes the outputs of all finished jobs that follow the last
+     *                  written one, in job order
+     * Returns        : void
+    */
+
+    pthread_mutex_lock(&P->outLock);
+    P->text[j] = text;
+    P->length[j] = length;
+    while(P->written < P->count && P->text[P->written] != NULL){
+        fwrite(P->text[P->written], 1, P->length[P->written], P->out);
+        free(P->text[P->written]);
+        P->written++;
+    }
+    pthread_mutex_unlock(&P->outLock);
+}
+
+int CompareJobFile(const void *a, const void *b){
+
+    BATCHJOB *x = *(BATCHJOB **)a, *y = *(BATCHJOB **)b;
+    int c = strcmp(x->file, y->file);
+    if(c != 0) return c;
+    return x < y ? -1 : x > y;
+}
+
+int ParseTask(char *name){
+
+    /*
+     * Arguments      : Character pointer to task name (max | need | both)
+     * Task Performed : Maps task name to TASK_* value, exits on unknown task name
+     * Returns        : Task value
+    */
+
+    if(strcmp(name,"max")==0)  return TASK_MAX;
+    if(strcmp(name,"need")==0) return TASK_NEED;
+    if(strcmp(name,"both")==0) return TASK_BOTH;
+
+    printf("Unknown task %s (expected max | need | both).\n",name);
+    exit(0);
+}
+
+int ParseOutput(char *name){
+
+    /*
+     * Arguments      : Character pointer to output name (value | nonzero | cut | binary)
+     * Task Performed : Maps output name to OUTPUT_* value, exits on unknown output name
+     * Returns        : Output value
+    */
+
+    if(strcmp(name,"value")==0)   return OUTPUT_VALUE;
+    if(strcmp(name,"nonzero")==0) return OUTPUT_NONZERO;
+    if(strcmp(name,"cut")==0)     return OUTPUT_CUT;
+    if(strcmp(name,"binary")==0)  return OUTPUT_BINARY;
+
+    printf("Unknown output %s (expected value | nonzero | cut | binary).\n",name);
+    exit(0);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+/* --- Benchmark Functions (instance generators & timing harness) --*/
+
+void GenerateGraph(char *kind, int size, unsigned long long seed, char *fname){
+
+    /*
+     * Arguments      : Instance kind, size parameter, random seed, character pointer to File Name
+     * Task Performed : Writes an instance in the text format read by ReadGraph, source is always vertex 1 & sink vertex V :
+     *                  random    -> V = size, 4V random arcs with capacity 1 .. 1000
+     *                  grid      -> size x size 4-connected pixel grid (arcs both ways, capacity 1 .. 100) with terminal
+     *                               arcs from the source & to the sink of capacity 0 .. 100 (vision style)
+     *                  layered   -> size layers of size vertices, every vertex has 3 arcs into the next layer,
+     *                               many augmenting paths of equal length (hard for Edmonds-Karp)
+     *                  bipartite -> size + size vertices, unit arcs from every left vertex to 5 distinct right vertices,
+     *                               unit source & sink arcs (matching)
+     *                  rmat      -> V = 2^size, 8V arcs drawn by R-MAT (a, b, c, d = .57, .19, .19, .05), power law degrees
+     *                               (size at most GEN_MAX_SCALE)
+     *                  Needs are -D for the source & D for the sink, D = half the capacity leaving the source
+     * Returns        : void
+     * NOTE           : Sizes whose vertex count does not fit in int or whose edge count could exceed GEN_MAX_EDGES are refused
+    */
+
+    EDGELIST L;
+    L.E = 0;
+    L.size = 1024;
+    L.x = (int *)malloc(L.size*sizeof(int));
+    L.y = (int *)malloc(L.size*sizeof(int));
+    L.c = (int *)malloc(L.size*sizeof(int));
+    unsigned long long state = seed ? seed : 88172645463325252ULL;
+    if(size < 1) size = 1;
+
+    double n = size, vertices = 0, edges = 0;       //Counts are bounded in double, so that they cannot overflow themselves
+    if(strcmp(kind,"random")==0)         { vertices = n;       edges = 4*n; }
+    else if(strcmp(kind,"grid")==0)      { vertices = n*n + 2; edges = 6*n*n; }
+    else if(strcmp(kind,"layered")==0)   { vertices = n*n + 2; edges = 3*n*n + 2*n; }
+    else if(strcmp(kind,"bipartite")==0) { vertices = 2*n + 2; edges = 7*n; }
+    if(vertices > INT_MAX || edges > GEN_MAX_EDGES){
+        printf("Instance %s of size %d is too large, it could have more than %d edges or %d vertices.\n",kind,size,GEN_MAX_EDGES,INT_MAX);
+        exit(0);
+    }
+
+    if(strcmp(kind,"random")==0){
+        L.V = size < 2 ? 2 : size;
+        for(int i=0;i<4*L.V;i++){
+            int x = 1 + GenRandom(&state,L.V), y = 1 + GenRandom(&state,L.V);
+            if(x != y) AddGenEdge(&L, x, y, 1 + GenRandom(&state,1000));
+        }
+    }
+    else if(strcmp(kind,"grid")==0){
+        int k = size;
+        L.V = k*k + 2;
+        for(int r=0;r<k;r++){
+            for(int c=0;c<k;c++){
+                int v = 2 + r*k + c;
+                if(c+1 < k){
+                    AddGenEdge(&L, v, v+1, 1 + GenRandom(&state,100));
+                    AddGenEdge(&L, v+1, v, 1 + GenRandom(&state,100));
+                }
+                if(r+1 < k){
+                    AddGenEdge(&L, v, v+k, 1 + GenRandom(&state,100));
+                    AddGenEdge(&L, v+k, v, 1 + GenRandom(&state,100));
+                }
+                int source = GenRandom(&state,101), sink = GenRandom(&state,101);
+                if(source) AddGenEdge(&L, 1, v, source);
+                if(sink)   AddGenEdge(&L, v, L.V, sink);
+            }
+        }
+    }
+    else if(strcmp(kind,"layered")==0){
+        int w = size;
+        L.V = w*w + 2;
+        for(int layer=0;layer<w;layer++){
+            for(int i=0;i<w;i++){
+                int v = 2 + layer*w + i;
+                if(layer == 0)   AddGenEdge(&L, 1, v, 1 + GenRandom(&state,1000));
+                if(layer == w-1) AddGenEdge(&L, v, L.V, 1 + GenRandom(&state,1000));
+                else for(int j=0;j<3;j++) AddGenEdge(&L, v, 2 + (layer+1)*w + GenRandom(&state,w), 1 + GenRandom(&state,1000));
+            }
+        }
+    }
+    else if(strcmp(kind,"bipartite")==0){
+        int n = size;
+        L.V = 2*n + 2;
+        for(int i=0;i<n;i++){
+            AddGenEdge(&L, 1, 2 + i, 1);
+            AddGenEdge(&L, 2 + n + i, L.V, 1);
+            int pick[5], picks = n < 5 ? n : 5;
+            for(int j=0;j<picks;j++){                   //Distinct right vertices (rejection), so no parallel edges get merged
+                int again = 1;
+                while(again){
+                    pick[j] = GenRandom(&state,n);
+                    again = 0;
+                    for(int k=0;k<j;k++) if(pick[k] == pick[j]) again = 1;
+                }
+                AddGenEdge(&L, 2 + i, 2 + n + pick[j], 1);
+            }
+        }
+    }
+    else if(strcmp(kind,"rmat")==0){
+        int scale = size > GEN_MAX_SCALE ? GEN_MAX_SCALE : size;
+        L.V = 1 << scale;
+        if(L.V < 2) L.V = 2;
+        for(long i=0;i<8L*L.V;i++){
+            int x = 0, y = 0;
+            for(int b=0;b<scale;b++){
+                int r = GenRandom(&state,100);
+                if(r < 57)      { }                         //Quadrant a
+                else if(r < 76) y |= 1 << b;                //Quadrant b
+                else if(r < 95) x |= 1 << b;                //Quadrant c
+                else          { x |= 1 << b; y |= 1 << b; } //Quadrant d
+            }
+            //Vertex 0 has the highest degree & becomes the source, vertex 1 (also of high degree) becomes the sink V
+            x = x == 1 ? L.V : (x == L.V - 1 ? 2 : x + 1);
+            y = y == 1 ? L.V : (y == L.V - 1 ? 2 : y + 1);
+            if(x != y) AddGenEdge(&L, x, y, 1 + GenRandom(&state,1000));
+        }
+    }
+    else{
+        printf("Unknown instance kind %s (expected random | grid | layered | bipartite | rmat).\n",kind);
+        exit(0);
+    }
+
+    FILE *fptr = fopen(fname, "w");
+    if (fptr == NULL){
+        printf("Could not open file %s.\n",fname);
+        exit(0);
+    }
+    setvbuf(fptr, NULL, _IOFBF, 1 << 20);
+
+    long D = 0;
+    for(int i=0;i<L.E;i++) if(L.x[i] == 1) D += L.c[i];
+    D = D/2 > INT_MAX ? INT_MAX : D/2;
+
+    fprintf(fptr, "%d %d\n", L.V, L.E);
+    for(int v=1;v<=L.V;v++) fprintf(fptr, "%ld%c", v == 1 ? -D : (v == L.V ? D : 0), v < L.V ? ' ' : '\n');
+    for(int i=0;i<L.E;i++) fprintf(fptr, "%d %d %d\n", L.x[i], L.y[i], L.c[i]);
+    fclose(fptr);
+
+    free(L.x);
+    free(L.y);
+    free(L.c);
+}
+
+void AddGenEdge(EDGELIST *L, int x, int y, int c){
+
+    if(L->E == L->size){
+        L->size *= 2;
+        L->x = (int *)realloc(L->x, L->size*sizeof(int));
+        L->y = (int *)realloc(L->y, L->size*sizeof(int));
+        L->c = (int *)realloc(L->c, L->size*sizeof(int));
+    }
+    L->x[L->E] = x;
+    L->y[L->E] = y;
+    L->c[L->E] = c;
+    L->E++;
+}
+
+int GenRandom(unsigned long long *state, int n){
+
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return (int)(((*state * 2685821657736338717ULL) >> 33) % (unsigned long long)n);
+}
+
+void RunBenchmark(char *fname, int s, int t, int runs){
+
+    /*
+     * Arguments      : Character pointer to File Name, source vertex : s, sink vertex : t, number of runs
+     * Task Performed : 1) Every run is done by a fresh child process (BenchmarkRun), so runs do not share memory & the
+     *                     peak resident set size of each run is read from wait4
+     *                  2) Timings of every phase & the results come back through a pipe
+     *                  3) Prints one JSON object : instance, engine, results, median / p90 / p99 / min / max / mean of each
+     *                     phase in seconds & median / max peak RSS in KB
+     * Returns        : void
+    */
+
+    double *sample = (double *)malloc(BENCH_PHASES*runs*sizeof(double));    //sample[p*runs + r]
+    double *rss = (double *)malloc(runs*sizeof(double));
+    int result[3] = {0, 0, 0};                                              //need feasible, V, E
+    CAP flow = 0;
+
+    for(int r=0;r<runs;r++){
+
+        int fd[2];
+        if(pipe(fd) != 0){
+            printf("Could not create pipe.\n");
+            exit(0);
+        }
+
+        fflush(stdout);
+        pid_t pid = fork();
+        if(pid == 0){
+            double phase[BENCH_PHASES];
+            int childResult[3];
+            CAP childFlow;
+            close(fd[0]);
+            BenchmarkRun(fname, s, t, phase, childResult, &childFlow);
+            if(write(fd[1], phase, sizeof(phase)) < 0 || write(fd[1], childResult, sizeof(childResult)) < 0 ||
+               write(fd[1], &childFlow, sizeof(childFlow)) < 0) _exit(1);
+            close(fd[1]);
+            _exit(0);
+        }
+
+        close(fd[1]);
+        double phase[BENCH_PHASES];
+        if(read(fd[0], phase, sizeof(phase)) != sizeof(phase) || read(fd[0], result, sizeof(result)) != sizeof(result) ||
+           read(fd[0], &flow, sizeof(flow)) != sizeof(flow)){
+            printf("Benchmark run %d failed.\n", r);
+            exit(0);
+        }
+        close(fd[0]);
+
+        int status;
+        struct rusage usage;
+        wait4(pid, &status, 0, &usage);
+        rss[r] = usage.ru_maxrss;
+        for(int p=0;p<BENCH_PHASES;p++) sample[p*runs + r] = phase[p];
+    }
+
+    char *names[BENCH_PHASES] = {"load", "reorder", "setup", "solve", "need_construct", "need_setup", "need_solve"};
+
+    printf("{\"file\": \"%s\", \"engine\": \"%s\", \"threads\": %d, \"reorder\": \"%s\", \"V\": %d, \"E\": %d, \"s\": %d, \"t\": %d, \"runs\": %d,\n",
+           fname, EngineName(Engine), Threads, ReorderName(Reorder), result[1], result[2], s, t, runs);
+    printf(" \"flow\": " CAP_FMT ", \"need_feasible\": %s,\n \"phases\": {\n", flow, result[0] ? "true" : "false");
+    for(int p=0;p<BENCH_PHASES;p++) PrintPhaseStats(names[p], sample + p*runs, runs, p == BENCH_PHASES-1);
+    qsort(rss, runs, sizeof(double), CompareDouble);
+    printf(" },\n \"peak_rss_kb\": {\"median\": %.0f, \"max\": %.0f}}\n", rss[runs/2], rss[runs-1]);
+
+    free(sample);
+    free(rss);
+}
+
+void BenchmarkRun(char *fname, int s, int t, double *phase, int *result, CAP *flow){
+
+    /*
+     * Arguments      : Character pointer to File Name, source vertex : s, sink vertex : t, array of phase timings to fill,
+     *                  array of results to fill (need feasible, V, E), pointer to flow value to fill
+     * Task Performed : Times separately : ReadGraph (load), ReorderGraph (reorder, 0 without -reorder), BuildResidual
+     *                  (setup, free for binary files kept in file order), SolveMaxFlow (solve, so Hopcroft-Karp, -reduce &
+     *                  Dinic for unit capacity graphs are used as by ComputeMaxFlow), then for need based flow
+     *                  AddNeedEdges, BuildResidual & SolveMaxFlow
+     * Returns        : void
+    */
+
+    double start = WallTime();
+    GRAPH *G = ReadGraph(fname);
+    phase[0] = WallTime() - start;
+    result[1] = G->V;
+    result[2] = G->E;
+
+    start = WallTime();
+    ReorderGraph(G, Reorder);
+    s = InternalId(G, s);
+    t = InternalId(G, t);
+    phase[1] = WallTime() - start;
+
+    start = WallTime();
+    if(G->R == NULL) G->R = BuildResidual(G);
+    phase[2] = WallTime() - start;
+
+    start = WallTime();
+    *flow = SolveMaxFlow(G, s, t);
+    phase[3] = WallTime() - start;
+
+    ResetFlow(G);
+    start = WallTime();
+    int added = AddNeedEdges(G);
+    phase[4] = WallTime() - start;
+
+    start = WallTime();
+    if(added) G->R = BuildResidual(G);
+    phase[5] = WallTime() - start;
+
+    start = WallTime();
+    if(added) SolveMaxFlow(G, G->V-1, G->V);
+    phase[6] = WallTime() - start;
+    result[0] = added && checkFeasibility(G);
+    DestroyGraph(G);
+}
+
+void PrintPhaseStats(char *name, double *sample, int runs, int last){
+
+    qsort(sample, runs, sizeof(double), CompareDouble);
+
+    double mean = 0;
+    for(int r=0;r<runs;r++) mean += sample[r];
+    mean /= runs;
+
+    //Nearest rank percentiles
+    int p90 = (int)(0.90*runs + 0.999999) - 1;
+    int p99 = (int)(0.99*runs + 0.999999) - 1;
+    printf("  \"%s\": {\"median\": %.6f, \"p90\": %.6f, \"p99\": %.6f, \"min\": %.6f, \"max\": %.6f, \"mean\": %.6f}%s\n",
+           name, sample[runs/2], sample[p90 < 0 ? 0 : p90], sample[p99 < 0 ? 0 : p99], sample[0], sample[runs-1], mean, last ? "" : ",");
+}
+
+int CompareDouble(const void *a, const void *b){
+
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+/* --- Capacity Update Functions (warm start) --*/
+
+int UpdateCapacities(GRAPH *G, int s, int t, CAPUPDATE *update, int count){
+
+    /*
+     * Arguments      : Pointer to solved Graph, source vertex : s, sink vertex : t, array of capacity updates & its size
+     * Task Performed : For every update of edge (x, y) to capacity c :
+     *                  1) Finds the forward arc of (x, y) among the arcs of x & sets its capacity (negative c is taken as 0)
+     *                  2) If the flow on the arc exceeds c, lowers it to c, which leaves excess at x & a deficit at y
+     *                  3) Reroutes the excess along residual paths from x to y (flow value is unchanged)
+     *                  4) Whatever cannot be rerouted is sent back from x to s & pulled back from t to y (flow value drops)
+     *                  Increases need no repair, a following ComputeMaxFlow continues augmenting from the current flow.
+     *                  Only arcs whose flow changed are written back to EDGE::f, so cost depends on the size of the change.
+     *                  Vertices whose arcs changed are noted with BKMarkVertex, so a following Boykov-Kolmogorov solve
+     *                  repairs its search trees there instead of growing them again from s & t
+     * Returns        : Number of updates applied
+     * NOTE           : Edges that do not exist are skipped, so are raises that could make flows overflow CAP (CapRaiseFits).
+     *                  Raising an edge of capacity 0 (which has no arc) rebuilds the residual network
+    */
+
+    if(G->R == NULL) G->R = BuildResidual(G);
+    RESIDUAL *R = G->R;
+
+    int *parent = (int*)malloc((R->V + 1)*sizeof(int));
+    int *queue  = (int*)malloc((R->V + 1)*sizeof(int));
+    int *mark   = (int*)calloc(R->V + 1, sizeof(int));  //mark[v] == stamp if v was visited by the current BFS
+    int stamp = 0;
+    int applied = 0;
+
+    for(int k=0;k<count;k++){
+
+        int x = InternalId(G,update[k].x), y = InternalId(G,update[k].y);
+        CAP c = update[k].c > 0 ? update[k].c : 0;
+        if(x < 1 || x > R->V || y < 1 || y > R->V) continue;
+
+        int a = -1;
+        for(int b=R->first[x]; b<R->first[x+1]; b++){
+            if(R->edge[b] != NULL && R->head[b] == y){
+                a = b;
+                break;
+            }
+        }
+
+        if(c > (a == -1 ? 0 : R->cap[a]) && !CapRaiseFits(G,x,y,c - (a == -1 ? 0 : R->cap[a]))){
+            printf("Edge (%d,%d) is not raised, the capacities around its vertices would add up beyond the capacity type.\n",update[k].x,update[k].y);
+            continue;
+        }
+
+        if(a == -1){
+            EDGE *p = G->H[x].p;
+            while(p != NULL && p->y != y) p = p->next;
+            if(p == NULL){
+                printf("Edge (%d,%d) does not exist.\n",update[k].x,update[k].y);
+                continue;
+            }
+            p->c = c;                                     //Edge had capacity 0 & flow 0, so it has no arc yet
+            if(!CAP_UNIT(c)) G->U = 0;
+            if(CAP_POSITIVE(c)){
+                FreeResidual(R);                          //EDGE::f is in sync with the arcs, so no flow is lost
+                G->R = R = BuildResidual(G);
+            }
+            applied++;
+            continue;
+        }
+
+        applied++;
+        R->edge[a]->c = c;
+        R->cap[a] = c;
+        if(!CAP_UNIT(c)) G->U = 0;
+        BKMarkVertex(R,x);                                //Search trees of a Boykov-Kolmogorov solve check x & y again
+        BKMarkVertex(R,y);
+        if(R->flow[a] <= c) continue;
+
+        CAP delta = R->flow[a] - c;
+        R->flow[a] = c;
+        R->flow[R->rev[a]] = -c;
+        R->edge[a]->f = c;
+
+        CAP left = delta - RepairFlow(R,x,y,delta,parent,queue,mark,&stamp);
+        if(CAP_POSITIVE(left)){
+            if(x != s && x != t) RepairFlow(R,x,s,left,parent,queue,mark,&stamp);   //Return excess of x to s
+            if(y != s && y != t) RepairFlow(R,t,y,left,parent,queue,mark,&stamp);   //Cover deficit of y from t
+        }
+    }
+
+    free(parent);
+    free(queue);
+    free(mark);
+    return applied;
+}
+
+CAP RepairFlow(RESIDUAL *R, int from, int to, CAP amount, int *parent, int *queue, int *mark, int *stamp){
+
+    /*
+     * Arguments      : Pointer to Residual Network, vertices from & to, amount of flow to move, work arrays of size V+1 :
+     *                  parent (arc entering a vertex), queue, mark (visited stamps) & pointer to current stamp
+     * Task Performed : Repeatedly finds a residual path from -> to by BFS (stopping as soon as to is reached) & pushes
+     *                  min(amount left, bottleneck) along it, updating EDGE::f of every changed arc
+     * Returns        : Amount of flow moved
+    */
+
+    CAP moved = 0;
+
+    while(CAP_POSITIVE(amount - moved)){
+
+        (*stamp)++;
+        int front = 0, rear = 0;
+        mark[from] = *stamp;
+        queue[rear++] = from;
+
+        while(front < rear && mark[to] != *stamp){
+            int v = queue[front++];
+            for(int a=R->first[v]; a<R->first[v+1]; a++){
+                int w = R->head[a];
+                if(mark[w] == *stamp || !CAP_POSITIVE(R->cap[a] - R->flow[a])) continue;
+                mark[w] = *stamp;
+                parent[w] = a;
+                queue[rear++] = w;
+            }
+        }
+        if(mark[to] != *stamp) break;                    //No residual path left
+
+        CAP newFlow = amount - moved;
+        for(int v=to; v!=from; v=R->head[R->rev[parent[v]]]){
+            int a = parent[v];
+            if(R->cap[a] - R->flow[a] < newFlow) newFlow = R->cap[a] - R->flow[a];
+        }
+        for(int v=to; v!=from; v=R->head[R->rev[parent[v]]]){
+            int a = parent[v];
+            PushArc(R,a,newFlow);
+            BKMarkVertex(R,v);
+            BKMarkVertex(R,R->head[R->rev[a]]);
+            if(R->edge[a] != NULL)         R->edge[a]->f = R->flow[a];
+            if(R->edge[R->rev[a]] != NULL) R->edge[R->rev[a]]->f = R->flow[R->rev[a]];
+        }
+        moved += newFlow;
+    }
+
+    return moved;
+}
+
+int ReadUpdates(char *fname, CAPUPDATE **update){
+
+    /*
+     * Arguments      : Character pointer to File Name, pointer to array of updates to be allocated
+     * Task Performed : Reads capacity updates, one "x y c" triple per line, until end of file
+     * Returns        : Number of updates read
+    */
+
+    FILE *fptr = fopen(fname, "r");
+    if (fptr == NULL){
+        printf("Could not open file %s.\n",fname);
+        exit(0);
+    }
+
+    int count = 0, size = 16;
+    *update = (CAPUPDATE *)malloc(size*sizeof(CAPUPDATE));
+    CAPUPDATE u;
+    while(fscanf(fptr,"%d %d " CAP_SCAN,&u.x,&u.y,&u.c) == 3){
+        if(count == size){
+            size *= 2;
+            *update = (CAPUPDATE *)realloc(*update, size*sizeof(CAPUPDATE));
+        }
+        (*update)[count++] = u;
+    }
+    fclose(fptr);
+    return count;
+}
+
+void ResetFlow(GRAPH *G){
+
+    /*
+     * Arguments      : Pointer to Graph
+     * Task Performed : Sets flow of every edge & every arc of the residual network to zero
+     * Returns        : void
+    */
+
+    for(int i=1;i<=G->V;i++){
+        for(EDGE *p = G->H[i].p; p!=NULL; p=p->next) p->f = 0;
+    }
+    if(G->R != NULL){
+        for(int a=0;a<G->R->A;a++) G->R->flow[a] = 0;
+        FreeSearchTrees(G->R);
+    }
+}
+
+CAP FlowValue(RESIDUAL *R, int s){
+
+    CAPWIDE value = 0;
+    for(int a=R->first[s]; a<R->first[s+1]; a++) value += R->flow[a];
+    return NarrowCap(value, "The flow value");
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+/* --- Solver Engines (operate on residual network, return value of maximum flow) --*/
+
+CAP EdmondsKarp(RESIDUAL *R, int s, int t){
+
+    /*
+     * Based on       : Edmonds-Karp Algorithm
+     * Arguments      : Pointer to Residual Network, source vertex : s, sink vertex : t
+     * Task Performed : 1) Finds shortest augmenting path with maximum residual capacity (among shortest paths) using function BFS, 
+     *                  2) Stores augmenting path using a parent array where parent[i] is the arc entering vertex i, 
+     *                     A vertex j with no parent has parent [j]= -1
+     *                  3) To find the augmenting path, we backtrack till source vertex using parent array
+     *                  4) Stores flow obtained from BFS function in var newFlow
+     *                  5) Increases maxFlow in each iteration till there exists an augmenting path by amount = newFlow
+     * Returns        : maximum flow from s to t
+    */
+
+   CAP maxFlow=0;
+   CAP newFlow=0; 
+   WORKSPACE * W = CreateWorkspace(R->V);     //BFS arrays are allocated once per solve
+   int * parent = W->parent;
+
+   while(!BudgetSpent(R,1) && CAP_POSITIVE(newFlow = BFS(s,t,R,W))){
+        
+        maxFlow = maxFlow + newFlow;
+        int cur = t;
+        STAT_ADD(augmentingPaths, 1);
+        
+        while (cur != s) {   //Backtrack till soucrce vertex is found
+            STAT_ADD(pathArcs, 1);
+
+            int a = parent[cur];                              //Arc of augmenting path entering cur
+            PushArc(R,a,newFlow);                             //Update flow of all arcs in augmenting path
+    
+            cur = R->head[R->rev[a]];
+        }
+   }
+
+   FreeWorkspace(W);
+   return maxFlow;
+}
+
+CAP CapacityScaling(RESIDUAL *R, int s, int t){
+
+    /*
+     * Based on       : Capacity Scaling (Edmonds-Karp restricted to arcs of large residual capacity)
+     * Arguments      : Pointer to Residual Network, source vertex : s, sink vertex : t
+     * Task Performed : 1) delta starts at the largest power of 2 not above the largest arc capacity
+     *                  2) Every phase augments along shortest paths (function BFS) using only arcs with residual capacity
+     *                     >= delta, until no such path is left, then halves delta
+     *                  3) The last phase uses delta = 0, i.e. every arc with residual capacity (for integer capacities it
+     *                     only confirms that no path is left after delta = 1)
+     *                  A phase leaves at most E * delta of flow to later phases, so each phase augments at most 2E times
+     *                  & the engine runs in O(E^2 log U) for largest capacity U
+     * Returns        : Value of flow added from s to t
+     * NOTE           : With -DMAXFLOW_STATS, augmenting paths of every phase are counted in Stats.scalingAugment
+    */
+
+    CAP maxCap = 0;
+    for(int a=0;a<R->A;a++) if(R->cap[a] > maxCap) maxCap = R->cap[a];
+
+    CAP delta = 1;
+    STAT(int bucket = 1;)
+    while(delta <= maxCap/2){
+        delta *= 2;
+        STAT(bucket++;)
+    }
+
+    CAP maxFlow = 0;
+    WORKSPACE *W = CreateWorkspace(R->V);
+    int *parent = W->parent;
+
+    while(1){
+
+        CAP newFlow;
+        STAT(long phasePaths = 0;)
+        W->delta = delta;
+
+        while(!BudgetSpent(R,1) && CAP_POSITIVE(newFlow = BFS(s,t,R,W))){
+
+            maxFlow = maxFlow + newFlow;
+            STAT(phasePaths++;)
+            for(int cur = t; cur != s; cur = R->head[R->rev[parent[cur]]]){
+                STAT_ADD(pathArcs, 1);
+                PushArc(R,parent[cur],newFlow);
+            }
+        }
+        STAT(STAT_ADD(augmentingPaths, phasePaths); STAT_ADD(scalingAugment[bucket < SCALING_BUCKETS ? bucket : SCALING_BUCKETS-1], phasePaths);)
+
+        if(!CAP_POSITIVE(delta) || R->stopped) break;
+        delta = delta >= 2 ? delta/2 : 0;
+        STAT(bucket = CAP_POSITIVE(delta) ? bucket-1 : 0;)
+    }
+
+    FreeWorkspace(W);
+    return maxFlow;
+}
+
+CAP Dinic(RESIDUAL *R, int s, int t){
+
+    /*
+     * Based on       : Dinic's Algorithm
+     * Arguments      : Pointer to Residual Network, source vertex : s, sink vertex : t
+     * Task Performed : 1) Every phase builds the level graph (level[v] = BFS distance of v from s) using function DinicLevelGraph
+     *                  2) Pushes a blocking flow through arcs (v, w) with level[w] = level[v] + 1 by an iterative DFS,
+     *                     where it[v] is the current arc of vertex v (arcs before it[v] are known to be useless in this phase)
+     *                  3) On reaching t, augments by the bottleneck of the path & retreats to the tail of the first saturated arc
+     *                  4) On a dead end, removes the vertex from the level graph & advances the current arc of its predecessor
+     *                  5) Stops when t is no longer reachable from s (or the budget of R ran out, see BudgetSpent)
+     * Returns        : maximum flow from s to t
+    */
+
+    if(s==t) return 0;
+
+    CAP maxFlow = 0;
+    int * level = (int*)malloc((R->V + 1)*sizeof(int));
+    int * it    = (int*)malloc((R->V + 1)*sizeof(int));
+    int * queue = (int*)malloc((R->V + 1)*sizeof(int));
+    int * path  = (int*)malloc((R->V + 1)*sizeof(int));   //Arcs of the current DFS path, path[0] leaves s
+    unsigned long long * frontier = (unsigned long long*)calloc(R->V/64 + 1, sizeof(unsigned long long));
+
+    while(!BudgetSpent(R,0) && DinicLevelGraph(R,s,t,level,queue,frontier)){
+
+        for(int v=1;v<=R->V;v++) it[v] = R->first[v];
+
+        int depth = 0;
+        int v = s;
+        while(1){
+
+            if(v == t){
+                if(BudgetSpent(R,1)) break;
+                CAP newFlow = CAP_MAX;
+                for(int i=0;i<depth;i++){
+                    CAP residualCapacity = R->cap[path[i]] - R->flow[path[i]];
+                    if(residualCapacity < newFlow) newFlow = residualCapacity;
+                }
+
+                int retreat = -1;
+                for(int i=0;i<depth;i++){
+                    int a = path[i];
+                    PushArc(R,a,newFlow);
+                    if(retreat == -1 && !CAP_POSITIVE(R->cap[a] - R->flow[a])) retreat = i;     //First saturated arc
+                }
+                maxFlow = maxFlow + newFlow;
+                STAT(STAT_ADD(augmentingPaths, 1); STAT_ADD(pathArcs, depth);)
+
+                depth = retreat;
+                v = R->head[R->rev[path[depth]]];
+                continue;
+            }
+
+            //Advance along the current arc of v
+            int a = it[v];
+            for(; a<R->first[v+1]; a++){
+                if(CAP_POSITIVE(R->cap[a] - R->flow[a]) && level[R->head[a]] == level[v] + 1) break;
+            }
+            it[v] = a;
+
+            if(a < R->first[v+1]){
+                path[depth++] = a;
+                v = R->head[a];
+            }
+            else{
+                level[v] = -1;                                //Dead end, v leaves the level graph
+                if(v == s) break;                             //Blocking flow found
+                depth--;
+                v = R->head[R->rev[path[depth]]];
+                it[v]++;
+            }
+        }
+        if(R->stopped) break;
+    }
+
+    free(level);
+    free(it);
+    free(queue);
+    free(path);
+    free(frontier);
+    return maxFlow;
+}
+
+int DetectBipartite(GRAPH *G, int s, int t, char *side){
+
+    /*
+     * Arguments      : Pointer to unit capacity Graph, source vertex : s, sink vertex : t, array side of size V+1 to fill
+     * Task Performed : Marks heads of edges leaving s as left (side 1) & tails of edges entering t as right (side 2), then
+     *                  checks that every edge of positive capacity is s -> left, left -> right or right -> t, or leaves an
+     *                  unmarked vertex (such a vertex cannot be reached from s, so its edges carry no flow)
+     * Returns        : 1 if the graph is a bipartite matching network (side filled), 0 if not
+    */
+
+    if(s == t) return 0;
+    memset(side, 0, G->V + 1);
+    for(EDGE *p = G->H[s].p; p!=NULL; p=p->next) if(CAP_POSITIVE(p->c)) side[p->y] |= 1;
+    for(int i=1;i<=G->V;i++){
+        for(EDGE *p = G->H[i].p; p!=NULL; p=p->next) if(CAP_POSITIVE(p->c) && p->y == t) side[i] |= 2;
+    }
+    if(side[s] || side[t]) return 0;                  //Covers edges s -> t, s -> s & t -> t
+
+    for(int i=1;i<=G->V;i++){
+        if(side[i] == 3) return 0;
+        for(EDGE *p = G->H[i].p; p!=NULL; p=p->next){
+            if(!CAP_POSITIVE(p->c) || side[i] == 0) continue;
+            if(side[i] == 2 && p->y == t) continue;
+            if(side[i] == 1 && side[p->y] == 2) continue;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+CAP HopcroftKarp(GRAPH *G, int s, char *side){
+
+    /*
+     * Based on       : Hopcroft-Karp Algorithm
+     * Arguments      : Pointer to bipartite unit capacity Graph, source vertex : s, sides from DetectBipartite (the sink
+     *                  is the only head of the edges leaving right vertices)
+     * Task Performed : 1) Numbers left & right vertices 0 .. L-1 & 0 .. R-1 & packs the left -> right edges in one array
+     *                     (adjacency of left vertex u at adj[first[u] .. first[u+1]-1]), keeping the EDGE of every entry
+     *                  2) Every phase runs a BFS from all free left vertices, building layers dist[] & stopping at the
+     *                     first layer that reaches a free right vertex. Right vertices seen by the BFS are kept in a bitset
+     *                  3) An iterative DFS along the layers (current entry it[u], dead ends get dist = INT_MAX) finds a
+     *                     maximal set of vertex disjoint shortest augmenting paths & flips them
+     *                  4) Stops when a phase finds no path, at most O(sqrt(V)) phases of O(E) each
+     *                  5) Writes the matching into EDGE::f : 1 on s -> u, u -> match(u) & match(u) -> t, 0 elsewhere
+     * Returns        : Size of the matching (value of maximum flow)
+    */
+
+    int V = G->V;
+    int *id = (int *)malloc((V + 1)*sizeof(int));
+    int L = 0, R = 0, E = 0;
+    for(int v=1;v<=V;v++){
+        if(side[v] == 1) id[v] = L++;
+        else if(side[v] == 2) id[v] = R++;
+    }
+
+    int *first = (int *)calloc(L + 1, sizeof(int));
+    for(int v=1;v<=V;v++){
+        if(side[v] != 1) continue;
+        for(EDGE *p = G->H[v].p; p!=NULL; p=p->next) if(CAP_POSITIVE(p->c)) first[id[v]+1]++;
+    }
+    for(int u=0;u<L;u++) first[u+1] += first[u];
+    E = first[L];
+    int *adj = (int *)malloc((E + 1)*sizeof(int));
+    EDGE **edge = (EDGE **)malloc((E + 1)*sizeof(EDGE *));
+    for(int v=1;v<=V;v++){
+        if(side[v] != 1) continue;
+        int k = first[id[v]];
+        for(EDGE *p = G->H[v].p; p!=NULL; p=p->next){
+            if(!CAP_POSITIVE(p->c)) continue;
+            adj[k] = id[p->y];
+            edge[k++] = p;
+        }
+    }
+
+    int *matchL = (int *)malloc((L + 1)*sizeof(int));     //matchL[u] stores the entry of adj matching u (-1 if free)
+    int *matchR = (int *)malloc((R + 1)*sizeof(int));     //matchR[r] stores the left vertex matched to r (-1 if free)
+    int *dist = (int *)malloc((L + 1)*sizeof(int));
+    int *it = (int *)malloc((L + 1)*sizeof(int));
+    int *queue = (int *)malloc((L + 1)*sizeof(int));
+    int *stack = (int *)malloc((L + 1)*sizeof(int));
+    int words = R/64 + 1;
+    unsigned long long *seen = (unsigned long long *)malloc(words*sizeof(unsigned long long));
+    for(int u=0;u<L;u++) matchL[u] = -1;
+    for(int r=0;r<R;r++) matchR[r] = -1;
+
+    CAP matching = 0;
+    while(1){
+
+        //BFS layers from all free left vertices
+        int front = 0, rear = 0, limit = INT_MAX;
+        memset(seen, 0, words*sizeof(unsigned long long));
+        for(int u=0;u<L;u++){
+            dist[u] = INT_MAX;
+            if(matchL[u] == -1){
+                dist[u] = 0;
+                queue[rear++] = u;
+            }
+        }
+        while(front < rear){
+            int u = queue[front++];
+            if(dist[u] >= limit) break;
+            for(int k=first[u]; k<first[u+1]; k++){
+                int r = adj[k];
+                if(seen[r >> 6] >> (r & 63) & 1) continue;
+                seen[r >> 6] |= 1ULL << (r & 63);
+                int w = matchR[r];
+                if(w == -1) limit = dist[u];                 //Shortest augmenting paths end at this layer
+                else if(dist[w] == INT_MAX){
+                    dist[w] = dist[u] + 1;
+                    queue[rear++] = w;
+                }
+            }
+        }
+        if(limit == INT_MAX) break;                          //No augmenting path left
+        STAT_ADD(matchingPhases, 1);
+
+        //DFS along the layers from every free left vertex
+        for(int u=0;u<L;u++) it[u] = first[u];
+        for(int u0=0;u0<L;u0++){
+            if(matchL[u0] != -1 || dist[u0] != 0) continue;
+            int top = 0;
+            stack[0] = u0;
+            while(top >= 0){
+                int u = stack[top];
+                if(it[u] == first[u+1]){                     //Dead end
+                    dist[u] = INT_MAX;
+                    top--;
+                    continue;
+                }
+                int r = adj[it[u]];
+                int w = matchR[r];
+                if(w == -1){
+                    if(dist[u] != limit){
+                        it[u]++;
+                        continue;
+                    }
+                    for(int j=top;j>=0;j--){                 //Flip the path, entry it[v] of every v leads to the next
+                        int v = stack[j];
+                        matchR[adj[it[v]]] = v;
+                        matchL[v] = it[v];
+                    }
+                    matching += 1;
+                    break;
+                }
+                if(dist[w] == dist[u] + 1) stack[++top] = w;
+                else it[u]++;
+            }
+        }
+    }
+
+    //Write matching back to the edges
+    for(int v=1;v<=V;v++){
+        for(EDGE *p = G->H[v].p; p!=NULL; p=p->next){
+            if(v == s)             p->f = CAP_POSITIVE(p->c) && matchL[id[p->y]] != -1;
+            else if(side[v] == 2)  p->f = CAP_POSITIVE(p->c) && matchR[id[v]] != -1;
+            else                   p->f = 0;
+        }
+    }
+    for(int u=0;u<L;u++) if(matchL[u] != -1) edge[matchL[u]]->f = 1;
+    STAT_ADD(matchingSolves, 1);
+
+    free(id);
+    free(first);
+    free(adj);
+    free(edge);
+    free(matchL);
+    free(matchR);
+    free(dist);
+    free(it);
+    free(queue);
+    free(stack);
+    free(seen);
+    return matching;
+}
+
+CAP PushRelabel(RESIDUAL *R, int s, int t){
+
+    /*
+     * Based on       : Goldberg-Tarjan Push-Relabel Method (highest-label variant)
+     * Arguments      : Pointer to Residual Network, source vertex : s, sink vertex : t
+     * Task Performed : 1) Computes excess of every vertex from the flow already on the arcs & saturates all arcs leaving s
+     *                  2) Phase 1 : Repeatedly discharges the active vertex with the highest height (PRDischarge),
+     *                     heights are recomputed exactly by PRGlobalRelabel whenever relabel work exceeds 6V + A,
+     *                     vertices that cannot reach t get height V & stay inactive in this phase
+     *                  3) Phase 2 : Excess stuck at vertices of height V is returned to s (PRReturnExcess),
+     *                     so that the arcs hold a valid flow & not just a preflow
+     * Returns        : maximum flow from s to t (excess of t)
+    */
+
+    if(s==t) return 0;
+
+    int n = R->V;
+    PUSHRELABEL P;
+    P.R = R;
+    P.s = s;
+    P.t = t;
+    P.excess     = (CAP*)calloc(n + 1, sizeof(CAP));
+    P.height     = (int*)malloc((n + 1)*sizeof(int));
+    P.it         = (int*)malloc((n + 1)*sizeof(int));
+    P.activeHead = (int*)malloc((n + 1)*sizeof(int));
+    P.activeNext = (int*)malloc((n + 1)*sizeof(int));
+    P.allHead    = (int*)malloc((n + 1)*sizeof(int));
+    P.allNext    = (int*)malloc((n + 1)*sizeof(int));
+    P.allPrev    = (int*)malloc((n + 1)*sizeof(int));
+    P.queue      = (int*)malloc((n + 1)*sizeof(int));
+
+    //Excess is the net inflow, which is zero for every vertex but s & t when arcs hold a valid flow
+    for(int v=1;v<=n;v++){
+        for(int a=R->first[v]; a<R->first[v+1]; a++) P.excess[v] -= R->flow[a];
+    }
+
+    //Saturate all arcs leaving s
+    for(int a=R->first[s]; a<R->first[s+1]; a++){
+        CAP d = R->cap[a] - R->flow[a];
+        if(!CAP_POSITIVE(d)) continue;
+        PushArc(R,a,d);
+        P.excess[R->head[a]] += d;
+        P.excess[s] -= d;
+    }
+
+    //Phase 1 : Maximum preflow
+    PRGlobalRelabel(&P);
+    while(P.maxActive >= 0){
+
+        if(P.work > 6L*n + R->A){
+            PRGlobalRelabel(&P);
+            continue;
+        }
+
+        int v = P.activeHead[P.maxActive];
+        if(v == 0){
+            P.maxActive--;
+            continue;
+        }
+        if(BudgetSpent(R,1)) break;                 //Phase 2 still turns the preflow into a flow
+        P.activeHead[P.maxActive] = P.activeNext[v];
+        PRDischarge(&P,v);
+    }
+
+    //Phase 2 : Convert preflow to flow
+    PRReturnExcess(&P);
+
+    CAP maxFlow = P.excess[t];
+
+    free(P.excess);
+    free(P.height);
+    free(P.it);
+    free(P.activeHead);
+    free(P.activeNext);
+    free(P.allHead);
+    free(P.allNext);
+    free(P.allPrev);
+    free(P.queue);
+    return maxFlow;
+}
+
+void PRGlobalRelabel(PUSHRELABEL *P){
+
+    /*
+     * Arguments      : Pointer to push-relabel state
+     * Task Performed : 1) Sets height of every vertex to its distance to t in the residual network (reverse BFS from t),
+     *                     vertices that cannot reach t (and s) get height V
+     *                  2) Rebuilds bucket lists of all vertices & active vertices with height < V
+     * Returns        : void
+    */
+
+    RESIDUAL *R = P->R;
+    int n = R->V;
+
+    for(int v=1;v<=n;v++){
+        P->height[v] = n;
+        P->it[v] = R->first[v];
+    }
+    for(int h=0;h<=n;h++){
+        P->activeHead[h] = 0;
+        P->allHead[h] = 0;
+    }
+    P->maxActive = -1;
+    P->maxAll = -1;
+    P->work = 0;
+
+    int front = 0, rear = 0;
+    P->height[P->t] = 0;
+    P->queue[rear++] = P->t;
+
+    while(front < rear){
+
+        int w = P->queue[front++];
+        int h = P->height[w];
+
+        //Insert w in the list of all vertices with height h
+        P->allPrev[w] = 0;
+        P->allNext[w] = P->allHead[h];
+        if(P->allHead[h]) P->allPrev[P->allHead[h]] = w;
+        P->allHead[h] = w;
+        if(h > P->maxAll) P->maxAll = h;
+
+        if(w != P->t && CAP_POSITIVE(P->excess[w])){
+            P->activeNext[w] = P->activeHead[h];
+            P->activeHead[h] = w;
+            if(h > P->maxActive) P->maxActive = h;
+        }
+
+        for(int a=R->first[w]; a<R->first[w+1]; a++){
+            int u = R->head[a];
+            int b = R->rev[a];                                  //Arc u -> w
+            if(P->height[u] == n && u != P->s && CAP_POSITIVE(R->cap[b] - R->flow[b])){
+                P->height[u] = h + 1;
+                P->queue[rear++] = u;
+            }
+        }
+    }
+}
+
+void PRDischarge(PUSHRELABEL *P, int v){
+
+    /*
+     * Arguments      : Pointer to push-relabel state, active vertex v (already removed from its active list)
+     * Task Performed : 1) Pushes excess of v along admissible arcs (residual capacity > 0 & height one lower) starting at it[v]
+     *                  2) When no admissible arc is left, relabels v to 1 + minimum height of its residual neighbours
+     *                  3) Gap heuristic : If v was the last vertex with its height h, no vertex above h can reach t,
+     *                     so all of them (and v) get height V
+     * Returns        : void
+    */
+
+    RESIDUAL *R = P->R;
+    int n = R->V;
+
+    while(CAP_POSITIVE(P->excess[v])){
+
+        int a;
+        for(a=P->it[v]; a<R->first[v+1]; a++){
+
+            int w = R->head[a];
+            CAP residualCapacity = R->cap[a] - R->flow[a];
+            if(!CAP_POSITIVE(residualCapacity) || P->height[w] != P->height[v] - 1) continue;
+
+            CAP d = P->excess[v] < residualCapacity ? P->excess[v] : residualCapacity;
+            PushArc(R,a,d);
+            P->excess[v] -= d;
+
+            if(!CAP_POSITIVE(P->excess[w]) && w != P->t){         //w becomes active
+                P->activeNext[w] = P->activeHead[P->height[w]];
+                P->activeHead[P->height[w]] = w;
+                if(P->height[w] > P->maxActive) P->maxActive = P->height[w];
+            }
+            P->excess[w] += d;
+
+            if(!CAP_POSITIVE(P->excess[v])) break;
+        }
+
+        if(a < R->first[v+1]){
+            P->it[v] = a;                                         //Arc may still be admissible, resume from it next time
+            break;
+        }
+
+        //Relabel : remove v from the list of its height
+        int h = P->height[v];
+        if(P->allPrev[v]) P->allNext[P->allPrev[v]] = P->allNext[v];
+        else              P->allHead[h] = P->allNext[v];
+        if(P->allNext[v]) P->allPrev[P->allNext[v]] = P->allPrev[v];
+
+        if(P->allHead[h] == 0){
+            //Gap at height h
+            for(int g=h+1; g<=P->maxAll; g++){
+                for(int u=P->allHead[g]; u; u=P->allNext[u]) P->height[u] = n;
+                P->allHead[g] = 0;
+                P->activeHead[g] = 0;
+            }
+            P->maxAll = h - 1;
+            if(P->maxActive > h - 1) P->maxActive = h - 1;
+            P->height[v] = n;
+            break;
+        }
+
+        int newHeight = n;
+        for(int b=R->first[v]; b<R->first[v+1]; b++){
+            if(CAP_POSITIVE(R->cap[b] - R->flow[b]) && P->height[R->head[b]] + 1 < newHeight) newHeight = P->height[R->head[b]] + 1;
+        }
+        P->work += 12 + R->first[v+1] - R->first[v];
+        P->height[v] = newHeight;
+        P->it[v] = R->first[v];
+        if(newHeight >= n) break;
+
+        P->allPrev[v] = 0;
+        P->allNext[v] = P->allHead[newHeight];
+        if(P->allHead[newHeight]) P->allPrev[P->allHead[newHeight]] = v;
+        P->allHead[newHeight] = v;
+        if(newHeight > P->maxAll) P->maxAll = newHeight;
+    }
+}
+
+void PRReturnExcess(PUSHRELABEL *P){
+
+    /*
+     * Arguments      : Pointer to push-relabel state after phase 1
+     * Task Performed : 1) Sets height of every vertex to its distance to s in the residual network (reverse BFS from s),
+     *                     t gets an unreachable height so that no flow is pushed into it
+     *                  2) Discharges vertices with excess in FIFO order towards s, every excess unit came from s, so a
+     *                     residual path back to s always exists
+     * Returns        : void
+    */
+
+    RESIDUAL *R = P->R;
+    int n = R->V;
+    int s = P->s;
+    int t = P->t;
+
+    for(int v=1;v<=n;v++){
+        P->height[v] = 2*n;
+        P->it[v] = R->first[v];
+    }
+
+    int front = 0, rear = 0;
+    P->height[s] = 0;
+    P->queue[rear++] = s;
+    while(front < rear){
+        int w = P->queue[front++];
+        for(int a=R->first[w]; a<R->first[w+1]; a++){
+            int u = R->head[a];
+            int b = R->rev[a];
+            if(P->height[u] == 2*n && u != t && CAP_POSITIVE(R->cap[b] - R->flow[b])){
+                P->height[u] = P->height[w] + 1;
+                P->queue[rear++] = u;
+            }
+        }
+    }
+    P->height[t] = INT_MAX/2;
+
+    //Queue of vertices with excess, used circularly
+    front = 0; rear = 0;
+    int size = 0;
+    for(int v=1;v<=n;v++){
+        if(v != s && v != t && CAP_POSITIVE(P->excess[v])){
+            P->queue[rear] = v;
+            rear = (rear + 1) % (n + 1);
+            size++;
+        }
+    }
+
+    while(size > 0){
+
+        int v = P->queue[front];
+        front = (front + 1) % (n + 1);
+        size--;
+
+        while(CAP_POSITIVE(P->excess[v])){
+
+            int a;
+            for(a=P->it[v]; a<R->first[v+1]; a++){
+
+                int w = R->head[a];
+                CAP residualCapacity = R->cap[a] - R->flow[a];
+                if(!CAP_POSITIVE(residualCapacity) || P->height[w] != P->height[v] - 1) continue;
+
+                CAP d = P->excess[v] < residualCapacity ? P->excess[v] : residualCapacity;
+                PushArc(R,a,d);
+                P->excess[v] -= d;
+                if(!CAP_POSITIVE(P->excess[w]) && w != s){
+                    P->queue[rear] = w;
+                    rear = (rear + 1) % (n + 1);
+                    size++;
+                }
+                P->excess[w] += d;
+
+                if(!CAP_POSITIVE(P->excess[v])) break;
+            }
+
+            if(a < R->first[v+1]){
+                P->it[v] = a;
+                break;
+            }
+
+            int newHeight = INT_MAX/2;
+            for(int b=R->first[v]; b<R->first[v+1]; b++){
+                if(CAP_POSITIVE(R->cap[b] - R->flow[b]) && P->height[R->head[b]] + 1 < newHeight) newHeight = P->height[R->head[b]] + 1;
+            }
+            P->height[v] = newHeight;
+            P->it[v] = R->first[v];
+        }
+    }
+}
+
+CAP ParallelPushRelabel(RESIDUAL *R, int s, int t){
+
+    /*
+     * Based on       : Hong & He's Lock-Free Push-Relabel Algorithm
+     * Arguments      : Pointer to Residual Network, source vertex : s, sink vertex : t (global var Threads gives thread count)
+     * Task Performed : 1) Copies residual capacities & excesses into atomic arrays & saturates all arcs leaving s
+     *                  2) Works in rounds : threads claim vertices of the active list through an atomic cursor & discharge them
+     *                     (PPRDischargeTask), vertices that receive excess are appended to the active list of the next round
+     *                  3) Recomputes heights by parallel BFS (PPRGlobalRelabel) at start & whenever V relabels were done
+     *                  4) Heights are not capped at V, so excess that cannot reach t flows back to s & the result is a flow
+     *                  5) Copies residual capacities back to the flow of every arc
+     *                  A budget of R (BudgetSpent) is checked once per round, excess left when it runs out is returned to s
+     *                  with PRReturnExcess
+     * Returns        : maximum flow from s to t (excess of t)
+    */
+
+    if(s==t) return 0;
+
+    int n = R->V;
+    PARALLELPR P;
+    P.R = R;
+    P.s = s;
+    P.t = t;
+    P.res    = (ATOMIC_CAP*)malloc((R->A + 1)*sizeof(ATOMIC_CAP));
+    P.excess = (ATOMIC_CAP*)malloc((n + 1)*sizeof(ATOMIC_CAP));
+    P.height = (atomic_int*)malloc((n + 1)*sizeof(atomic_int));
+    P.queued = (atomic_int*)malloc((n + 1)*sizeof(atomic_int));
+    P.active = (int*)malloc((n + 1)*sizeof(int));
+    P.next   = (int*)malloc((n + 1)*sizeof(int));
+
+    for(int a=0;a<R->A;a++) atomic_init(&P.res[a], R->cap[a] - R->flow[a]);
+    for(int v=0;v<=n;v++){
+        CAP e = 0;
+        if(v > 0) for(int a=R->first[v]; a<R->first[v+1]; a++) e -= R->flow[a];
+        atomic_init(&P.excess[v], e);
+        atomic_init(&P.height[v], 0);
+        atomic_init(&P.queued[v], 0);
+    }
+    atomic_init(&P.nextCount, 0);
+    atomic_init(&P.cursor, 0);
+    atomic_init(&P.relabels, 0);
+
+    //Saturate all arcs leaving s
+    for(int a=R->first[s]; a<R->first[s+1]; a++){
+        CAP d = atomic_load(&P.res[a]);
+        if(!CAP_POSITIVE(d)) continue;
+        atomic_store(&P.res[a], 0);
+        CapFetchAdd(&P.res[R->rev[a]], d);
+        CapFetchAdd(&P.excess[R->head[a]], d);
+        CapFetchAdd(&P.excess[s], -d);
+    }
+
+    int threads = Threads > 0 ? Threads : 1;
+    pthread_t *worker = (pthread_t*)malloc(threads*sizeof(pthread_t));
+    pthread_barrier_init(&P.barrier, NULL, threads);
+    for(int i=1;i<threads;i++) pthread_create(&worker[i], NULL, PPRWorker, &P);
+
+    PPRGlobalRelabel(&P);
+
+    P.activeCount = 0;
+    for(int v=1;v<=n;v++){
+        if(v != s && v != t && CAP_POSITIVE(atomic_load(&P.excess[v]))) P.active[P.activeCount++] = v;
+    }
+
+    while(P.activeCount > 0 && !BudgetSpent(R,1)){
+
+        if(atomic_load(&P.relabels) > n){
+            PPRGlobalRelabel(&P);
+            atomic_store(&P.relabels, 0);
+        }
+
+        //Mark vertices of this round as queued, so that they are not appended to the next round before they are claimed
+        for(int i=0;i<P.activeCount;i++) atomic_store(&P.queued[P.active[i]], 1);
+        atomic_store(&P.cursor, 0);
+        atomic_store(&P.nextCount, 0);
+        PPRRunTask(&P, PPR_TASK_DISCHARGE);
+
+        int *swap = P.active;
+        P.active = P.next;
+        P.next = swap;
+        P.activeCount = atomic_load(&P.nextCount);
+    }
+
+    PPRRunTask(&P, PPR_TASK_EXIT);
+    for(int i=1;i<threads;i++) pthread_join(worker[i], NULL);
+    pthread_barrier_destroy(&P.barrier);
+
+    //Flow of the lower arc of every pair decides both, so flow[rev[a]] = -flow[a] holds exactly for any capacity type
+    for(int a=0;a<R->A;a++){
+        if(a > R->rev[a]) continue;
+        R->flow[a] = R->cap[a] - atomic_load(&P.res[a]);
+        R->flow[R->rev[a]] = -R->flow[a];
+    }
+    CAP maxFlow = atomic_load(&P.excess[t]);
+
+    if(P.activeCount > 0){
+        //Stopped on the budget : excess still held by vertices is returned to s by phase 2 of the sequential engine
+        PUSHRELABEL Q;
+        Q.R = R;
+        Q.s = s;
+        Q.t = t;
+        Q.excess = (CAP*)malloc((n + 1)*sizeof(CAP));
+        Q.height = (int*)malloc((n + 1)*sizeof(int));
+        Q.it     = (int*)malloc((n + 1)*sizeof(int));
+        Q.queue  = (int*)malloc((n + 1)*sizeof(int));
+        for(int v=0;v<=n;v++) Q.excess[v] = atomic_load(&P.excess[v]);
+        PRReturnExcess(&Q);
+        free(Q.excess);
+        free(Q.height);
+        free(Q.it);
+        free(Q.queue);
+    }
+
+    free(worker);
+    free(P.res);
+    free(P.excess);
+    free(P.height);
+    free(P.queued);
+    free(P.active);
+    free(P.next);
+    return maxFlow;
+}
+
+CAP CapFetchAdd(ATOMIC_CAP *p, CAP d){
+
+    /*
+     * Arguments      : Pointer to atomic capacity, amount d to add (may be negative)
+     * Task Performed : Atomically adds d, floating point atomics have no fetch & add, so a compare & swap loop is used
+     * Returns        : Value before the addition
+    */
+
+#ifdef CAP_DOUBLE
+    CAP old = atomic_load_explicit(p, memory_order_relaxed);
+    while(!atomic_compare_exchange_weak(p, &old, old + d));
+    return old;
+#else
+    return atomic_fetch_add(p, d);
+#endif
+}
+
+void PPRRunTask(PARALLELPR *P, int task){
+
+    /*
+     * Arguments      : Pointer to parallel push-relabel state, task id
+     * Task Performed : Called by the main thread only. Releases the workers waiting on the barrier, runs the task itself
+     *                  & waits on the barrier until every thread has finished it
+     * Returns        : void
+    */
+
+    P->task = task;
+    pthread_barrier_wait(&P->barrier);
+    if(task == PPR_TASK_EXIT) return;
+    if(task == PPR_TASK_DISCHARGE) PPRDischargeTask(P);
+    else                           PPRExpandTask(P);
+    pthread_barrier_wait(&P->barrier);
+}
+
+void *PPRWorker(void *arg){
+
+    PARALLELPR *P = (PARALLELPR*)arg;
+
+    while(1){
+        pthread_barrier_wait(&P->barrier);                  //Wait for the next task
+        if(P->task == PPR_TASK_EXIT) break;
+        if(P->task == PPR_TASK_DISCHARGE) PPRDischargeTask(P);
+        else                              PPRExpandTask(P);
+        pthread_barrier_wait(&P->barrier);                  //Task finished
+    }
+    return NULL;
+}
+
+void PPRDischargeTask(PARALLELPR *P){
+
+    /*
+     * Arguments      : Pointer to parallel push-relabel state
+     * Task Performed : Claims vertices u of the active list one at a time & repeats until u has no excess :
+     *                  1) Finds the neighbour v with the lowest height among residual arcs of u
+     *                  2) If height[u] > height[v], pushes min(excess, residual capacity) to v with atomic updates,
+     *                     v is appended to the next round if its excess was zero (once, guarded by queued[v])
+     *                  3) Otherwise relabels u to height[v] + 1
+     *                  Since only the owner of u decreases excess[u] & residual capacities of arcs leaving u,
+     *                  values read by the owner are lower bounds & pushes never overdraw
+     * Returns        : void
+    */
+
+    RESIDUAL *R = P->R;
+
+    while(1){
+
+        int i = atomic_fetch_add(&P->cursor, 1);
+        if(i >= P->activeCount) break;
+
+        int u = P->active[i];
+        atomic_store(&P->queued[u], 0);
+
+        while(1){
+
+            CAP e = atomic_load(&P->excess[u]);
+            if(!CAP_POSITIVE(e)) break;
+
+            int best = -1;
+            int lowest = INT_MAX;
+            for(int a=R->first[u]; a<R->first[u+1]; a++){
+                if(!CAP_POSITIVE(atomic_load_explicit(&P->res[a], memory_order_relaxed))) continue;
+                int h = atomic_load_explicit(&P->height[R->head[a]], memory_order_relaxed);
+                if(h < lowest){
+                    lowest = h;
+                    best = a;
+                }
+            }
+            if(best == -1) break;                               //Cannot happen, excess always has a residual path back to s
+
+            if(atomic_load(&P->height[u]) > lowest){
+
+                int v = R->head[best];
+                CAP r = atomic_load(&P->res[best]);
+                CAP d = e < r ? e : r;
+                CapFetchAdd(&P->res[best], -d);
+                CapFetchAdd(&P->res[R->rev[best]], d);
+                CapFetchAdd(&P->excess[u], -d);
+
+                CAP before = CapFetchAdd(&P->excess[v], d);
+                if(!CAP_POSITIVE(before) && v != P->s && v != P->t){
+                    int expected = 0;
+                    if(atomic_compare_exchange_strong(&P->queued[v], &expected, 1)){
+                        P->next[atomic_fetch_add(&P->nextCount, 1)] = v;
+                    }
+                }
+            }
+            else{
+                atomic_store(&P->height[u], lowest + 1);
+                atomic_fetch_add_explicit(&P->relabels, 1, memory_order_relaxed);
+            }
+        }
+    }
+}
+
+void PPRExpandTask(PARALLELPR *P){
+
+    /*
+     * Arguments      : Pointer to parallel push-relabel state
+     * Task Performed : Claims vertices w of the current BFS frontier (active list) in chunks & labels every unlabelled vertex u
+     *                  with a residual arc u -> w with level + 1, a compare & swap on height[u] decides which thread adds u
+     *                  to the next frontier
+     * Returns        : void
+    */
+
+    RESIDUAL *R = P->R;
+    int unlabelled = INT_MAX;
+
+    while(1){
+
+        int start = atomic_fetch_add(&P->cursor, 64);
+        if(start >= P->activeCount) break;
+        int end = start + 64 < P->activeCount ? start + 64 : P->activeCount;
+
+        for(int i=start;i<end;i++){
+            int w = P->active[i];
+            for(int a=R->first[w]; a<R->first[w+1]; a++){
+                int u = R->head[a];
+                if(atomic_load_explicit(&P->height[u], memory_order_relaxed) != unlabelled) continue;
+                if(!CAP_POSITIVE(atomic_load_explicit(&P->res[R->rev[a]], memory_order_relaxed))) continue;
+
+                int expected = unlabelled;
+                if(atomic_compare_exchange_strong(&P->height[u], &expected, P->level + 1)){
+                    P->next[atomic_fetch_add(&P->nextCount, 1)] = u;
+                }
+            }
+        }
+    }
+}
+
+void PPRGlobalRelabel(PARALLELPR *P){
+
+    /*
+     * Arguments      : Pointer to parallel push-relabel state (threads idle)
+     * Task Performed : 1) Sets height of every vertex to its distance to t by level synchronous reverse BFS from t,
+     *                     every level is expanded by all threads (PPRExpandTask)
+     *                  2) Vertices that cannot reach t get V + distance to s by a second BFS from s (height[s] = V)
+     *                  3) Vertices reaching neither get 2V
+     *                  Uses active & next lists as frontiers, so it must be called between rounds
+     * Returns        : void
+    */
+
+    int n = P->R->V;
+    for(int v=1;v<=n;v++) atomic_store(&P->height[v], INT_MAX);
+
+    int root[2] = {P->t, P->s};
+    int base[2] = {0, n};
+
+    for(int k=0;k<2;k++){
+
+        atomic_store(&P->height[root[k]], base[k]);
+        P->active[0] = root[k];
+        P->activeCount = 1;
+        P->level = base[k];
+
+        while(P->activeCount > 0){
+            atomic_store(&P->cursor, 0);
+            atomic_store(&P->nextCount, 0);
+            PPRRunTask(P, PPR_TASK_EXPAND);
+
+            int *swap = P->active;
+            P->active = P->next;
+            P->next = swap;
+            P->activeCount = atomic_load(&P->nextCount);
+            P->level++;
+        }
+    }
+
+    for(int v=1;v<=n;v++){
+        if(atomic_load(&P->height[v]) == INT_MAX) atomic_store(&P->height[v], 2*n);
+    }
+
+    //Rebuild the active list, which was used as BFS frontier
+    P->activeCount = 0;
+    for(int v=1;v<=n;v++){
+        atomic_store(&P->queued[v], 0);
+        if(v != P->s && v != P->t && CAP_POSITIVE(atomic_load(&P->excess[v]))) P->active[P->activeCount++] = v;
+    }
+}
+
+CAP BoykovKolmogorov(RESIDUAL *R, int s, int t){
+
+    /*
+     * Based on       : Boykov-Kolmogorov Algorithm (search trees reused between augmentations)
+     * Arguments      : Pointer to Residual Network, source vertex : s, sink vertex : t
+     * Task Performed : Keeps a source tree rooted at s & a sink tree rooted at t, grown over arcs with residual capacity :
+     *                  1) Growth  : an active vertex adds free neighbours to its tree (BKGrow) until an arc joining the
+     *                     two trees is found
+     *                  2) Augment : pushes the bottleneck along the tree paths through that arc, vertices whose arc to the
+     *                     parent is saturated become orphans (BKAugment)
+     *                  3) Adopt   : every orphan looks for a new parent in its tree whose path still leads to the root,
+     *                     otherwise it is freed & its children become orphans (BKAdopt)
+     *                  The vertex that found a path keeps growing until it finds no more, & ends when no vertex is active.
+     *                  The trees stay in R->bk afterwards. The next solve from the same s & t starts from them & only
+     *                  checks the vertices listed by BKMarkVertex, so a frame whose terminal capacities changed a little
+     *                  costs little (UpdateCapacities marks the vertices it touches)
+     * Returns        : Value of flow added from s to t
+     * NOTE           : No bound better than O(V^2 E |C|) is known, but on vision style grids (terminal arcs from every
+     *                  vertex, short paths everywhere) it is much faster than engines that search from scratch
+    */
+
+    if(s==t) return 0;
+
+    BOYKOVKOLMOGOROV *B = R->bk;
+    if(B != NULL && (B->s != s || B->t != t)){
+        FreeSearchTrees(R);
+        B = NULL;
+    }
+
+    if(B == NULL) R->bk = B = BKCreate(R,s,t);
+    else{
+        //Reuse : vertices whose arcs changed may have lost their arc to the parent & may grow again
+        B->time++;
+        for(int k=0;k<B->changedCount;k++){
+            int v = B->changed[k];
+            B->isChanged[v] = 0;
+            if(B->tree[v] == BK_FREE) continue;
+            int a = B->parent[v];
+            if(a >= 0){
+                int b = B->tree[v] == BK_SOURCE ? R->rev[a] : a;
+                if(!CAP_POSITIVE(R->cap[b] - R->flow[b])){
+                    B->parent[v] = BK_ORPHAN;
+                    BKOrphan(B,v);
+                }
+            }
+            BKActivate(R,B,v);
+        }
+        B->changedCount = 0;
+        BKAdopt(R,B);
+    }
+
+    CAP maxFlow = 0;
+    int current = 0;                    //Vertex that found the last path, grown again before the others
+
+    while(1){
+
+        int v = current;
+        if(v != 0 && B->tree[v] == BK_FREE){
+            B->isActive[v] = 0;
+            v = 0;
+        }
+        if(BudgetSpent(R,0)){
+            if(v != 0){                                   //Back to the active vertices, for a later solve from the trees
+                B->isActive[v] = 0;
+                BKActivate(R,B,v);
+            }
+            break;
+        }
+        while(v == 0 && B->activeCount > 0){
+            v = B->active[B->activeFront];
+            B->activeFront = B->activeFront == B->V ? 0 : B->activeFront + 1;
+            B->activeCount--;
+            if(B->tree[v] == BK_FREE){
+                B->isActive[v] = 0;
+                v = 0;
+            }
+        }
+        if(v == 0) break;
+
+        int b = BKGrow(R,B,v);
+        if(b < 0){
+            B->isActive[v] = 0;
+            current = 0;
+            continue;
+        }
+
+        current = v;
+        B->time++;
+        BudgetSpent(R,1);
+        maxFlow += BKAugment(R,B,b);
+        BKAdopt(R,B);
+    }
+
+    return maxFlow;
+}
+
+BOYKOVKOLMOGOROV *BKCreate(RESIDUAL *R, int s, int t){
+
+    /*
+     * Arguments      : Pointer to Residual Network, source vertex : s, sink vertex : t
+     * Task Performed : Allocates the search trees, every vertex is free but s (root of the source tree) & t (root of the
+     *                  sink tree), which are both active
+     * Returns        : Pointer to search trees
+    */
+
+    int n = R->V;
+    BOYKOVKOLMOGOROV *B = (BOYKOVKOLMOGOROV *)malloc(sizeof(BOYKOVKOLMOGOROV));
+    B->V = n;
+    B->s = s;
+    B->t = t;
+    B->tree      = (char *)calloc(n + 1, 1);
+    B->parent    = (int *)malloc((n + 1)*sizeof(int));
+    B->dist      = (int *)calloc(n + 1, sizeof(int));
+    B->ts        = (int *)calloc(n + 1, sizeof(int));
+    B->it        = (int *)malloc((n + 1)*sizeof(int));
+    B->active    = (int *)malloc((n + 1)*sizeof(int));
+    B->isActive  = (char *)calloc(n + 1, 1);
+    B->orphan    = (int *)malloc((n + 1)*sizeof(int));
+    B->changed   = (int *)malloc((n + 1)*sizeof(int));
+    B->isChanged = (char *)calloc(n + 1, 1);
+    B->time = 0;
+    B->activeFront = B->activeCount = 0;
+    B->orphanFront = B->orphanCount = 0;
+    B->changedCount = 0;
+
+    for(int v=0;v<=n;v++) B->parent[v] = BK_NONE;
+    B->tree[s] = BK_SOURCE;
+    B->tree[t] = BK_SINK;
+    B->parent[s] = B->parent[t] = BK_TERMINAL;
+    B->dist[s] = B->dist[t] = 1;
+    BKActivate(R,B,s);
+    BKActivate(R,B,t);
+    return B;
+}
+
+int BKGrow(RESIDUAL *R, BOYKOVKOLMOGOROV *B, int v){
+
+    /*
+     * Arguments      : Pointer to Residual Network, pointer to search trees, active vertex v
+     * Task Performed : Scans the arcs of v from it[v] on that have residual capacity away from the root of its tree (v -> w
+     *                  in the source tree, w -> v in the sink tree) : a free w joins the tree of v & becomes active, a w of
+     *                  the same tree whose distance is known to be larger takes v as its parent. A vertex that found a
+     *                  path resumes at that arc, so s & t, which may have an arc to every vertex, are not scanned again
+     *                  from the start after every augmentation
+     * Returns        : Arc from the source tree to the sink tree with residual capacity, -1 if v reaches no vertex of the
+     *                  other tree
+    */
+
+    int X = B->tree[v];
+    for(int a=B->it[v]; a<R->first[v+1]; a++){
+
+        STAT_ADD(arcsScanned, 1);
+        int b = X == BK_SOURCE ? a : R->rev[a];          //Arc that needs residual capacity
+        if(!CAP_POSITIVE(R->cap[b] - R->flow[b])) continue;
+
+        int w = R->head[a];
+        if(B->tree[w] == BK_FREE){
+            B->tree[w] = X;
+            B->parent[w] = R->rev[a];
+            B->dist[w] = B->dist[v] + 1;
+            B->ts[w] = B->ts[v];
+            BKActivate(R,B,w);
+        }
+        else if(B->tree[w] != X){
+            B->it[v] = a;                                 //Scanned again after the augmentation, it may have capacity left
+            return b;
+        }
+        else if(B->ts[w] <= B->ts[v] && B->dist[w] > B->dist[v]){
+            B->parent[w] = R->rev[a];                     //Shorter path to the root
+            B->dist[w] = B->dist[v] + 1;
+            B->ts[w] = B->ts[v];
+        }
+    }
+    B->it[v] = R->first[v+1];
+    return -1;
+}
+
+CAP BKAugment(RESIDUAL *R, BOYKOVKOLMOGOROV *B, int b){
+
+    /*
+     * Arguments      : Pointer to Residual Network, pointer to search trees, arc b from the source tree to the sink tree
+     * Task Performed : Finds the bottleneck of the path s -> .. -> tail of b -> head of b -> .. -> t along the parent arcs,
+     *                  pushes it & makes every vertex whose arc to its parent got saturated an orphan
+     * Returns        : Amount of flow pushed
+    */
+
+    CAP d = R->cap[b] - R->flow[b];
+    for(int v=R->head[R->rev[b]]; B->parent[v] != BK_TERMINAL; v=R->head[B->parent[v]]){
+        int a = R->rev[B->parent[v]];
+        if(R->cap[a] - R->flow[a] < d) d = R->cap[a] - R->flow[a];
+    }
+    for(int v=R->head[b]; B->parent[v] != BK_TERMINAL; v=R->head[B->parent[v]]){
+        int a = B->parent[v];
+        if(R->cap[a] - R->flow[a] < d) d = R->cap[a] - R->flow[a];
+    }
+
+    STAT_ADD(augmentingPaths, 1);
+    PushArc(R,b,d);
+    for(int v=R->head[R->rev[b]]; B->parent[v] != BK_TERMINAL; ){
+        int a = R->rev[B->parent[v]];
+        int next = R->head[B->parent[v]];
+        STAT_ADD(pathArcs, 1);
+        PushArc(R,a,d);
+        if(!CAP_POSITIVE(R->cap[a] - R->flow[a])){
+            B->parent[v] = BK_ORPHAN;
+            BKOrphan(B,v);
+        }
+        v = next;
+    }
+    for(int v=R->head[b]; B->parent[v] != BK_TERMINAL; ){
+        int a = B->parent[v];
+        int next = R->head[a];
+        STAT_ADD(pathArcs, 1);
+        PushArc(R,a,d);
+        if(!CAP_POSITIVE(R->cap[a] - R->flow[a])){
+            B->parent[v] = BK_ORPHAN;
+            BKOrphan(B,v);
+        }
+        v = next;
+    }
+    return d;
+}
+
+void BKAdopt(RESIDUAL *R, BOYKOVKOLMOGOROV *B){
+
+    /*
+     * Arguments      : Pointer to Residual Network, pointer to search trees
+     * Task Performed : Takes orphans in FIFO order. An orphan v looks among the neighbours w of its tree that have
+     *                  residual capacity towards it (w -> v in the source tree, v -> w in the sink tree) for those whose
+     *                  parent path ends at the root, & takes the one closest to the root. Distances found on the way are
+     *                  stamped with the current time, so later walks stop early. Without such a neighbour v is freed : its
+     *                  children become orphans & neighbours of its tree that could reach it are made active
+     * Returns        : void
+    */
+
+    while(B->orphanCount > 0){
+
+        int v = B->orphan[B->orphanFront];
+        B->orphanFront = B->orphanFront == B->V ? 0 : B->orphanFront + 1;
+        B->orphanCount--;
+        int X = B->tree[v];
+
+        int best = BK_NONE, bestDist = INT_MAX;
+        for(int a=R->first[v]; a<R->first[v+1]; a++){
+            int b = X == BK_SOURCE ? R->rev[a] : a;
+            int w = R->head[a];
+            if(B->tree[w] != X || !CAP_POSITIVE(R->cap[b] - R->flow[b])) continue;
+
+            //Walk up from w until a vertex stamped with the current time, the root or another orphan
+            int d = 0, u = w;
+            while(1){
+                if(B->ts[u] == B->time){
+                    d += B->dist[u];
+                    break;
+                }
+                int p = B->parent[u];
+                d++;
+                if(p == BK_TERMINAL){
+                    B->ts[u] = B->time;
+                    B->dist[u] = 1;
+                    break;
+                }
+                if(p == BK_ORPHAN){
+                    d = INT_MAX;
+                    break;
+                }
+                u = R->head[p];
+            }
+            if(d == INT_MAX) continue;
+
+            if(d < bestDist){
+                best = a;
+                bestDist = d;
+            }
+            for(u=w; B->ts[u] != B->time; u=R->head[B->parent[u]]){
+                B->ts[u] = B->time;
+                B->dist[u] = d--;
+            }
+        }
+
+        if(best != BK_NONE){
+            B->parent[v] = best;
+            B->ts[v] = B->time;
+            B->dist[v] = bestDist + 1;
+            continue;
+        }
+
+        //No parent left : v leaves its tree
+        for(int a=R->first[v]; a<R->first[v+1]; a++){
+            int w = R->head[a];
+            if(B->tree[w] != X) continue;
+            int b = X == BK_SOURCE ? R->rev[a] : a;
+            if(CAP_POSITIVE(R->cap[b] - R->flow[b])) BKActivate(R,B,w);
+            int p = B->parent[w];
+            if(p >= 0 && R->head[p] == v){
+                B->parent[w] = BK_ORPHAN;
+                BKOrphan(B,w);
+            }
+        }
+        B->tree[v] = BK_FREE;
+        B->parent[v] = BK_NONE;
+    }
+}
+
+void BKActivate(RESIDUAL *R, BOYKOVKOLMOGOROV *B, int v){
+
+    B->it[v] = R->first[v];                         //Arcs before it[v] may have changed, even for a vertex already active
+    if(B->isActive[v]) return;
+    B->isActive[v] = 1;
+    int k = B->activeFront + B->activeCount++;
+    B->active[k > B->V ? k - B->V - 1 : k] = v;
+}
+
+void BKOrphan(BOYKOVKOLMOGOROV *B, int v){
+
+    int k = B->orphanFront + B->orphanCount++;      //A vertex is queued once, while its parent is BK_ORPHAN
+    B->orphan[k > B->V ? k - B->V - 1 : k] = v;
+}
+
+void BKMarkVertex(RESIDUAL *R, int v){
+
+    /*
+     * Arguments      : Pointer to Residual Network, vertex v
+     * Task Performed : Lists v among the vertices whose arcs changed since the last Boykov-Kolmogorov solve (nothing
+     *                  happens if R keeps no search trees)
+     * Returns        : void
+    */
+
+    BOYKOVKOLMOGOROV *B = R->bk;
+    if(B == NULL || B->isChanged[v]) return;
+    B->isChanged[v] = 1;
+    B->changed[B->changedCount++] = v;
+}
+
+void FreeSearchTrees(RESIDUAL *R){
+
+    BOYKOVKOLMOGOROV *B = R->bk;
+    if(B == NULL) return;
+    free(B->tree);
+    free(B->parent);
+    free(B->dist);
+    free(B->ts);
+    free(B->it);
+    free(B->active);
+    free(B->isActive);
+    free(B->orphan);
+    free(B->changed);
+    free(B->isChanged);
+    free(B);
+    R->bk = NULL;
+}
+
+void ScalingBenchmark(GRAPH *G, int s, int t, int maxThreads){
+
+    /*
+     * Arguments      : Pointer to Graph, source vertex : s, sink vertex : t, maximum thread count
+     * Task Performed : 1) Solves the graph once with the sequential push-relabel engine as reference
+     *                  2) Solves it with the parallel engine for 1, 2, 4, .. maxThreads threads, starting from zero flow each time
+     *                  3) Prints time, speedup over 1 thread & whether the flow value matches the reference
+     * Returns        : void
+    */
+
+    RESIDUAL *R = BuildResidual(G);
+    for(int a=0;a<R->A;a++) R->flow[a] = 0;
+
+    double start = WallTime();
+    CAP reference = PushRelabel(R,s,t);
+    double sequential = WallTime() - start;
+
+    printf("\nScaling benchmark (V = %d, A = %d), sequential push-relabel : " CAP_FMT " in %.3f s\n\n", R->V, R->A, reference, sequential);
+    printf("threads      time(s)   speedup   flow\n");
+
+    int saved = Threads;
+    double base = 0;
+    for(int threads=1; ; threads = threads*2 < maxThreads ? threads*2 : maxThreads){
+
+        for(int a=0;a<R->A;a++) R->flow[a] = 0;
+        Threads = threads;
+
+        start = WallTime();
+        CAP maxFlow = ParallelPushRelabel(R,s,t);
+        double elapsed = WallTime() - start;
+        if(threads == 1) base = elapsed;
+
+        printf("%7d %12.3f %9.2f   " CAP_FMT "%s\n", threads, elapsed, base/elapsed, maxFlow, CAP_EQUAL(maxFlow, reference) ? "" : "  MISMATCH");
+        if(threads >= maxThreads) break;
+    }
+    Threads = saved;
+
+    FreeResidual(R);
+}
+
+double WallTime(){
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int DinicLevelGraph(RESIDUAL *R, int s, int t, int *level, int *queue, unsigned long long *frontier){
+
+    /*
+     * Arguments      : Pointer to Residual Network, source vertex : s, sink vertex : t, level array, array used as queue,
+     *                  frontier bitmap of V/64+1 words (all bits clear)
+     * Task Performed : Performs BFS from s over arcs with positive residual capacity & stores distance of every vertex in level,
+     *                  A vertex j not reachable from s has level[j] = -1. Vertices at distance >= level[t] are not expanded.
+     *                  Every level is expanded top-down or bottom-up as chosen by BFSDirection (see BFS)
+     * Returns        : 1 if t is reachable from s, 0 if not
+    */
+
+    for(int i=0;i<=R->V;i++) level[i] = -1;
+    level[s] = 0;
+
+    int levelStart = 0, rear = 0, bottomUp = 0, *first = R->first;
+    queue[rear++] = s;
+    long frontierArcs = first[s+1] - first[s];
+    long unexploredArcs = R->A - frontierArcs;
+    STAT(long scanned = 0; long dequeued = 0;)
+
+    while(levelStart < rear && level[t] == -1){
+
+        int levelEnd = rear;
+        int next = level[queue[levelStart]] + 1;
+        bottomUp = BFSDirection(bottomUp, R->V, levelEnd - levelStart, frontierArcs, unexploredArcs);
+        frontierArcs = 0;
+
+        if(!bottomUp){
+            for(int i=levelStart;i<levelEnd;i++){
+                int v = queue[i];
+                STAT(scanned += first[v+1] - first[v]; dequeued++;)
+                for(int a=first[v]; a<first[v+1]; a++){
+                    int w = R->head[a];
+                    if(level[w] == -1 && CAP_POSITIVE(R->cap[a] - R->flow[a])){
+                        level[w] = next;
+                        queue[rear++] = w;
+                        frontierArcs += first[w+1] - first[w];
+                    }
+                }
+            }
+        }
+        else{
+            for(int i=levelStart;i<levelEnd;i++) frontier[queue[i] >> 6] |= 1ULL << (queue[i] & 63);
+            STAT(STAT_ADD(bottomUpSteps, 1);)
+            for(int v=1;v<=R->V;v++){
+                if(level[v] != -1) continue;
+                STAT(dequeued++;)
+                for(int a=first[v]; a<first[v+1]; a++){
+                    int u = R->head[a], b = R->rev[a];          //arc b leads from u to v
+                    STAT(scanned++;)
+                    if((frontier[u >> 6] >> (u & 63) & 1) && CAP_POSITIVE(R->cap[b] - R->flow[b])){
+                        level[v] = next;
+                        queue[rear++] = v;
+                        frontierArcs += first[v+1] - first[v];
+                        break;
+                    }
+                }
+            }
+            for(int i=levelStart;i<levelEnd;i++) frontier[queue[i] >> 6] = 0;
+        }
+
+        unexploredArcs -= frontierArcs;
+        levelStart = levelEnd;
+    }
+
+    STAT(STAT_ADD(bfsCalls, 1); STAT_ADD(verticesDequeued, dequeued); STAT_ADD(arcsScanned, scanned);)
+    return level[t] != -1;
+}
+
+#ifdef MAXFLOW_STATS
+//--------------------------------------------------------------------------------------------------------------------------------
+/* --- Instrumentation Functions --*/
+
+void PrintStats(){
+
+    /*
+     * Arguments      : None
+     * Task Performed : Prints the counters of the solver (summed over the run) as one JSON object on stderr, together with
+     *                  average augmenting path length & average arcs scanned per BFS. Registered with atexit by main
+     * Returns        : void
+    */
+
+    long paths = Stats.augmentingPaths, bfs = Stats.bfsCalls;
+
+    fprintf(stderr, "{\"engine\": \"%s\", \"solves\": %ld, \"augmenting_paths\": %ld, \"avg_path_length\": %.3f,\n",
+            EngineName(Engine), (long)Stats.solves, paths, paths ? (double)Stats.pathArcs/paths : 0.0);
+    fprintf(stderr, " \"bfs_calls\": %ld, \"vertices_dequeued\": %ld, \"arcs_scanned\": %ld, \"arcs_per_bfs\": %.1f,\n",
+            bfs, (long)Stats.verticesDequeued, (long)Stats.arcsScanned, bfs ? (double)Stats.arcsScanned/bfs : 0.0);
+    fprintf(stderr, " \"bottom_up_levels\": %ld,\n", (long)Stats.bottomUpSteps);
+    fprintf(stderr, " \"reverse_arcs\": %ld, \"need_edges\": %ld,\n", (long)Stats.reverseArcs, (long)Stats.needEdges);
+    if(Stats.matchingSolves > 0){
+        fprintf(stderr, " \"matching_solves\": %ld, \"matching_phases\": %ld,\n", (long)Stats.matchingSolves, (long)Stats.matchingPhases);
+    }
+    if(Reduce){
+        fprintf(stderr, " \"reduction\": {\"vertices\": %ld, \"vertices_kept\": %ld, \"edges\": %ld, \"arc_pairs_kept\": %ld, \"time\": %.6f},\n",
+                (long)Stats.reduceVertices, (long)Stats.reduceVerticesKept, (long)Stats.reduceEdges, (long)Stats.reduceEdgesKept,
+                Stats.reduceTime/1e9);
+    }
+
+    //Capacity scaling phases, largest delta first : "2^k" for delta = 2^k, "0" for the last phase
+    if(Engine == ENGINE_SCALING){
+        fprintf(stderr, " \"scaling_augmentations\": {");
+        int first = 1;
+        for(int k=SCALING_BUCKETS-1;k>=0;k--){
+            if(Stats.scalingAugment[k] == 0) continue;
+            if(k > 0) fprintf(stderr, "%s\"2^%d\": %ld", first ? "" : ", ", k-1, (long)Stats.scalingAugment[k]);
+            else      fprintf(stderr, "%s\"0\": %ld", first ? "" : ", ", (long)Stats.scalingAugment[k]);
+            first = 0;
+        }
+        fprintf(stderr, "},\n");
+    }
+    fprintf(stderr, " \"time\": {\"reorder\": %.6f, \"residual\": %.6f, \"solve\": %.6f, \"write_back\": %.6f, \"need_construct\": %.6f}}\n",
+            Stats.reorderTime/1e9, Stats.residualTime/1e9, Stats.solveTime/1e9, Stats.writeBackTime/1e9, Stats.needTime/1e9);
+}
+#endif
+
+//--------------------------------------------------------------------------------------------------------------------------------
+/* --- Residual Network Functions (Compressed Sparse Row) --*/
+
+RESIDUAL *BuildResidual(GRAPH *G){
+
+    /*
+     * Arguments      : Pointer to Graph
+     * Task Performed : 1) Counts forward & reverse arcs incident on every vertex (edges with zero capacity are skipped)
+     *                  2) Converts the counts to offsets so that the arcs of vertex v occupy first[v] .. first[v+1]-1
+     *                  3) Places every edge (x, y) as a forward arc at x and a reverse arc at y, each storing the index of the other
+     *                  4) Initialises flow of every arc with EDGE::f so that an existing flow is carried over
+     *                  The residual network has an arena of its own, so it can be rebuilt without growing the graph's arena
+     * Returns        : Pointer to residual network
+    */
+
+    ARENA *arena = NewArena();
+    RESIDUAL *R = (RESIDUAL *)ArenaAlloc(arena, sizeof(RESIDUAL));
+    R->V = G->V;
+    R->first = (int *)ArenaCalloc(arena, G->V + 2, sizeof(int));
+    R->bk = NULL;
+    R->deadline = 0;
+    R->steps = -1;
+    R->stopped = 0;
+    R->map = NULL;
+    R->mapSize = 0;
+    R->arena = arena;
+
+    //Degree counting, first[v+1] holds number of arcs leaving v
+    int m = 0;
+    for(int i=1;i<=G->V;i++){
+        for(EDGE *p = G->H[i].p; p!=NULL; p=p->next){
+            if(!CAP_POSITIVE(p->c)) continue;
+            R->first[i+1]++;
+            R->first[p->y+1]++;
+            m++;
+        }
+    }
+    R->A = 2*m;
+    STAT_ADD(reverseArcs, m);
+    for(int i=1;i<=G->V+1;i++) R->first[i] += R->first[i-1];
+
+    R->head = (int *)ArenaAlloc(arena, (R->A + 1)*sizeof(int));
+    R->cap  = (CAP *)ArenaAlloc(arena, (R->A + 1)*sizeof(CAP));
+    R->flow = (CAP *)ArenaAlloc(arena, (R->A + 1)*sizeof(CAP));
+    R->rev  = (int *)ArenaAlloc(arena, (R->A + 1)*sizeof(int));
+    R->edge = (EDGE **)ArenaAlloc(arena, (R->A + 1)*sizeof(EDGE *));
+    R->cost = G->W ? (int *)ArenaAlloc(arena, (R->A + 1)*sizeof(int)) : NULL;
+
+    int *pos = (int *)malloc((G->V + 1)*sizeof(int));     //Next free slot of every vertex
+    for(int i=0;i<=G->V;i++) pos[i] = R->first[i];
+
+    for(int i=1;i<=G->V;i++){
+        for(EDGE *p = G->H[i].p; p!=NULL; p=p->next){
+            if(!CAP_POSITIVE(p->c)) continue;
+
+            int a = pos[i]++;                 //Forward arc i -> y
+            int b = pos[p->y]++;              //Reverse arc y -> i
+
+            R->head[a] = p->y;   R->cap[a] = p->c;   R->flow[a] =  p->f;   R->rev[a] = b;   R->edge[a] = p;
+            R->head[b] = i;      R->cap[b] = 0;      R->flow[b] = -p->f;   R->rev[b] = a;   R->edge[b] = NULL;
+            if(R->cost != NULL){
+                R->cost[a] =  p->w;
+                R->cost[b] = -p->w;
+            }
+        }
+    }
+
+    free(pos);
+    return R;
+}
+
+void ReadBackFlow(RESIDUAL *R){
+
+    /*
+     * Arguments      : Pointer to Residual Network
+     * Task Performed : Sets flow of every forward arc from the EDGE it was built from (& of its reverse arc to the negative),
+     *                  used when edges got their flow from a solve that did not run on this network
+     * Returns        : void
+    */
+
+    FreeSearchTrees(R);
+    for(int a=0;a<R->A;a++){
+        if(R->edge[a] == NULL) continue;
+        R->flow[a] = R->edge[a]->f;
+        R->flow[R->rev[a]] = -R->edge[a]->f;
+    }
+}
+
+void WriteBackFlow(RESIDUAL *R){
+
+    /*
+     * Arguments      : Pointer to Residual Network
+     * Task Performed : Copies flow of every forward arc to the EDGE it was built from, so that PrintGraph shows the flow
+     * Returns        : void
+    */
+
+    for(int a=0;a<R->A;a++){
+        if(R->edge[a] != NULL) R->edge[a]->f = R->flow[a];
+    }
+}
+
+void PushArc(RESIDUAL *R, int a, CAP d){
+
+    /*
+     * Arguments      : Pointer to Residual Network, arc a, amount d (at most the residual capacity of a)
+     * Task Performed : Adds d to the flow of a & keeps flow[rev[a]] = -flow[a]. Pushing the whole residual capacity leaves
+     *                  the arc exactly saturated, so floating point capacities leave no rounding residue on bottleneck arcs
+     * Returns        : void
+    */
+
+    if(d >= R->cap[a] - R->flow[a]) R->flow[a] = R->cap[a];
+    else                            R->flow[a] += d;
+    R->flow[R->rev[a]] = -R->flow[a];
+}
+
+void FreeResidual(RESIDUAL *R){
+
+    FreeSearchTrees(R);                               //Only part not in the arena
+    if(R->map != NULL) munmap(R->map, R->mapSize);    //first, head, cap & rev point into the binary graph file
+    ReleaseArena(R->arena);                           //Everything else, including R itself, lives in the arena
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------
+/* --- Arena Functions (per graph memory, released at once & recycled) --*/
+
+ARENA *NewArena(){
+
+    /*
+     * Arguments      : None
+     * Task Performed : Takes the most recently released arena from the pool (its memory is kept for reuse),
+     *                  creates an empty arena if the pool is empty
+     * Returns        : Pointer to arena
+    */
+
+    pthread_mutex_lock(&ArenaPoolLock);
+    ARENA *A = ArenaPool;
+    if(A != NULL){
+        ArenaPool = A->next;
+        ArenaPoolSize--;
+    }
+    pthread_mutex_unlock(&ArenaPoolLock);
+
+    if(A == NULL){
+        A = (ARENA *)malloc(sizeof(ARENA));
+        A->chunk = NULL;
+        A->total = 0;
+    }
+    A->next = NULL;
+    return A;
+}
+
+void *ArenaAlloc(ARENA *A, size_t bytes){
+
+    /*
+     * Arguments      : Pointer to arena, number of bytes
+     * Task Performed : Hands out the next ARENA_ALIGN aligned bytes of the current chunk, when they do not fit starts a new
+     *                  chunk at least as large as all earlier chunks together (so an arena needs O(log size) chunks)
+     * Returns        : Pointer to allocated memory
+    */
+
+    size_t header = (sizeof(ARENACHUNK) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    bytes = (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    ARENACHUNK *C = A->chunk;
+    if(C == NULL || C->size - C->used < bytes){
+        size_t size = A->total > ARENA_CHUNK ? A->total : ARENA_CHUNK;
+        if(size < bytes) size = bytes;
+
+        C = (ARENACHUNK *)malloc(header + size);
+        if(C == NULL){
+            printf("Out of memory.\n");
+            exit(0);
+        }
+        C->size = size;
+        C->used = 0;
+        C->next = A->chunk;
+        A->chunk = C;
+        A->total += size;
+    }
+
+    void *p = (char *)C + header + C->used;
+    C->used += bytes;
+    return p;
+}
+
+void *ArenaCalloc(ARENA *A, size_t count, size_t size){
+
+    void *p = ArenaAlloc(A, count*size);
+    memset(p, 0, count*size);
+    return p;
+}
+
+void ReleaseArena(ARENA *A){
+
+    /*
+     * Arguments      : Pointer to arena
+     * Task Performed : 1) Frees all memory handed out by the arena at once
+     *                  2) An arena that grew over several chunks gets one chunk of the same total size instead,
+     *                     so the next graph of similar size fits without asking malloc again
+     *                  3) Keeps up to ARENA_POOL_MAX released arenas in the pool for NewArena, frees the rest
+     * Returns        : void
+    */
+
+    if(A->chunk != NULL && A->chunk->next != NULL){
+        size_t total = A->total;
+        while(A->chunk != NULL){
+            ARENACHUNK *C = A->chunk;
+            A->chunk = C->next;
+            free(C);
+        }
+        A->total = 0;
+        ArenaAlloc(A, total);                         //Single chunk of the combined size
+    }
+    if(A->chunk != NULL) A->chunk->used = 0;
+
+    pthread_mutex_lock(&ArenaPoolLock);
+    int keep = ArenaPoolSize < ARENA_POOL_MAX;
+    if(keep){
+        A->next = ArenaPool;
+        ArenaPool = A;
+        ArenaPoolSize++;
+    }
+    pthread_mutex_unlock(&ArenaPoolLock);
+
+    if(!keep){
+        while(A->chunk != NULL){
+            ARENACHUNK *C = A->chunk;
+            A->chunk = C->next;
+            free(C);
+        }
+        free(A);
+    }
+}
+
+void DestroyGraph(GRAPH *G){
+
+    /*
+     * Arguments      : Pointer to Graph
+     * Task Performed : Releases the residual network of the graph (if built) & the arena holding the graph, its vertices,
+     *                  its edges & the universal source / sink edges added by AddNeedEdges
+     * Returns        : void
+     * NOTE           : G must not be used afterwards
+    */
+
+    if(G->R != NULL) FreeResidual(G->R);
+    ReleaseArena(G->arena);                           //G itself lives in the arena
+}
 //--------------------------------------------------------------------------------------------------------------------------------